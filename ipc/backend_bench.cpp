@@ -0,0 +1,149 @@
+// backend_bench.cpp : Echo throughput and latency of the Server's epoll and
+// io_uring backends. Each backend runs in-process on an ephemeral localhost
+// port while client threads keep one request in flight per connection.
+//
+// Usage: BackendBench [connections] [seconds] [message bytes]
+//
+
+#include "epoll_server.h"
+#include "uring_server.h"
+#include "protocol.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    double messagesPerSecond;
+    double p50Us;
+    double p99Us;
+};
+
+SOCKET createListener(int& port) {
+    SOCKET listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    socklen_t length = sizeof(address);
+    if (listener == INVALID_SOCKET
+        || bind(listener, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR
+        || listen(listener, SOMAXCONN) == SOCKET_ERROR
+        || getsockname(listener, (sockaddr*)&address, &length) == SOCKET_ERROR) {
+        std::fprintf(stderr, "Failed to create listener: %s\n", socketErrorString().c_str());
+        exit(1);
+    }
+    port = ntohs(address.sin_port);
+    return listener;
+}
+
+// One client thread per connection: send a message frame, wait for the
+// reply frame, repeat until the deadline
+void runClient(int port, const std::string& message, Clock::time_point deadline,
+               std::vector<double>& latencies) {
+    SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (connect(client, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR) {
+        std::fprintf(stderr, "Failed to connect: %s\n", socketErrorString().c_str());
+        closesocket(client);
+        return;
+    }
+
+    std::string request;
+    appendFrame(request, FrameType::Message, message);
+    FrameParser input;
+    while (Clock::now() < deadline) {
+        auto start = Clock::now();
+        if (send(client, request.data(), request.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(request.size())) {
+            break;
+        }
+        Frame reply;
+        while (input.next(reply) != FrameParser::Status::Complete) {
+            char* space = input.prepare(BUFFER_SIZE);
+            ssize_t received = recv(client, space, input.writable(), 0);
+            if (received <= 0) {
+                closesocket(client);
+                return;
+            }
+            input.commit(static_cast<size_t>(received));
+        }
+        latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+    closesocket(client);
+}
+
+template<typename RunServer>
+Result runBackend(RunServer runServer, int connections, double seconds, size_t messageBytes) {
+    int port = 0;
+    SOCKET listener = createListener(port);
+    std::atomic<int> clientCount{ 0 };
+    std::atomic<bool> running{ true };
+
+    ReactorConfig config;
+    config.threads = std::max(1u, std::thread::hardware_concurrency());
+    std::thread server([&] { runServer(listener, config, clientCount, running); });
+
+    std::string message(messageBytes, 'x');
+    auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(seconds));
+    std::vector<std::vector<double>> latencies(connections);
+    std::vector<std::thread> clients;
+    for (int i = 0; i < connections; ++i) {
+        clients.emplace_back(runClient, port, std::cref(message), deadline, std::ref(latencies[i]));
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    running = false;
+    server.join();
+    closesocket(listener);
+
+    std::vector<double> all;
+    for (auto& perClient : latencies) {
+        all.insert(all.end(), perClient.begin(), perClient.end());
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double fraction) {
+        return all.empty() ? 0.0 : all[static_cast<size_t>(fraction * (all.size() - 1))];
+    };
+    return { all.size() / seconds, percentile(0.50), percentile(0.99) };
+}
+
+int main(int argc, char* argv[]) {
+    int connections = argc > 1 ? std::atoi(argv[1]) : 64;
+    double seconds = argc > 2 ? std::atof(argv[2]) : 3.0;
+    size_t messageBytes = argc > 3 ? static_cast<size_t>(std::atoi(argv[3])) : 64;
+    if (connections < 1 || seconds <= 0 || messageBytes < 1 || messageBytes > MAX_FRAME_PAYLOAD / 2) {
+        std::fprintf(stderr, "Usage: %s [connections] [seconds] [message bytes]\n", argv[0]);
+        return 1;
+    }
+
+    // Keep the servers' startup and per-connection lines off the terminal
+    std::cout.setstate(std::ios::badbit);
+    setLogLevel(LogLevel::Warning);
+
+    std::printf("%d connections, %zu byte messages, %.1f s per backend\n", connections, messageBytes, seconds);
+    std::printf("%-10s %14s %10s %10s\n", "backend", "messages/s", "p50 us", "p99 us");
+
+    Result epoll = runBackend(runEpollServer, connections, seconds, messageBytes);
+    std::printf("%-10s %14.0f %10.1f %10.1f\n", "epoll", epoll.messagesPerSecond, epoll.p50Us, epoll.p99Us);
+
+    std::string reason;
+    if (!uringAvailable(reason)) {
+        std::printf("%-10s unavailable: %s\n", "io_uring", reason.c_str());
+        return 0;
+    }
+    Result uring = runBackend(runUringServer, connections, seconds, messageBytes);
+    std::printf("%-10s %14.0f %10.1f %10.1f\n", "io_uring", uring.messagesPerSecond, uring.p50Us, uring.p99Us);
+    return 0;
+}
@@ -1,75 +1,42 @@
+#include "net.h"
+#include "protocol.h"
+#include "transport.h"
+
 #include <iostream>
 #include <string>
-#include <cstring>
-
-#ifdef _WIN32
-    #include <winsock2.h>
-    #include <ws2tcpip.h>
-    #pragma comment(lib, "ws2_32.lib")
-#else
-    #include <sys/socket.h>
-    #include <netinet/in.h>
-    #include <arpa/inet.h>
-    #include <unistd.h>
-    #define SOCKET int
-    #define INVALID_SOCKET -1
-    #define SOCKET_ERROR -1
-    #define closesocket close
-#endif
 
-constexpr int PORT = 8080;
-constexpr int BUFFER_SIZE = 1024;
-
-void initializeSockets() {
-#ifdef _WIN32
-    WSADATA wsaData;
-    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-        std::cerr << "WSAStartup failed" << std::endl;
-        exit(1);
+int main(int argc, char* argv[]) {
+    Endpoint endpoint;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string error;
+        if (arg.rfind("--connect=", 0) != 0 || !parseEndpoint(arg.substr(10), endpoint, error)) {
+            if (!error.empty()) {
+                std::cerr << "Client: " << error << std::endl;
+            }
+            std::cerr << "Usage: " << argv[0] << " [--connect=tcp:[HOST:]PORT|unix:PATH|seqpacket:PATH]" << std::endl;
+            return 1;
+        }
     }
-#endif
-}
 
-void cleanupSockets() {
-#ifdef _WIN32
-    WSACleanup();
-#endif
-}
-
-int main() {
     std::cout << "Client: Starting..." << std::endl;
     initializeSockets();
 
-    SOCKET clientSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    std::cout << "Client: Connecting to server at " << endpoint.describe() << "..." << std::endl;
+    std::string error;
+    SOCKET clientSocket = connectTo(endpoint, error);
     if (clientSocket == INVALID_SOCKET) {
-        std::cerr << "Client: Failed to create socket" << std::endl;
-        cleanupSockets();
-        return 1;
-    }
-
-    sockaddr_in serverAddr{};
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(PORT);
-    
-#ifdef _WIN32
-    inet_pton(AF_INET, "127.0.0.1", &serverAddr.sin_addr);
-#else
-    serverAddr.sin_addr.s_addr = inet_addr("127.0.0.1");
-#endif
-
-    std::cout << "Client: Connecting to server..." << std::endl;
-    if (connect(clientSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
-        std::cerr << "Client: Connection failed. Is the server running?" << std::endl;
-        closesocket(clientSocket);
+        std::cerr << "Client: " << error << ". Is the server running?" << std::endl;
         cleanupSockets();
         return 1;
     }
 
     std::cout << "Client: Connected to server!" << std::endl;
-    std::cout << "Type messages to send (type 'quit' to exit):" << std::endl;
+    std::cout << "Type messages to send (type 'stats' for server counters, 'quit' to exit):" << std::endl;
 
-    char buffer[BUFFER_SIZE];
+    FrameParser input;
     std::string message;
+    std::string output;
 
     while (true) {
         std::cout << "> ";
@@ -77,18 +44,38 @@ int main() {
 
         if (message.empty()) continue;
 
-        send(clientSocket, message.c_str(), static_cast<int>(message.length()), 0);
+        bool quit = message == "quit";
+        output.clear();
+        if (quit) {
+            appendFrame(output, FrameType::Quit, {});
+        } else if (message == "stats") {
+            appendFrame(output, FrameType::Stats, {});
+        } else {
+            appendFrame(output, FrameType::Message, message);
+        }
+        sendAll(clientSocket, output.data(), output.size(), endpoint.recordSize());
 
-        if (message == "quit") {
+        if (quit) {
             std::cout << "Client: Disconnecting..." << std::endl;
             break;
         }
 
-        memset(buffer, 0, BUFFER_SIZE);
-        int bytesReceived = recv(clientSocket, buffer, BUFFER_SIZE - 1, 0);
-        
-        if (bytesReceived > 0) {
-            std::cout << "Client: " << buffer << std::endl;
+        // Read until the whole reply frame is in
+        Frame reply;
+        FrameParser::Status status;
+        while ((status = input.next(reply)) == FrameParser::Status::NeedMore) {
+            char* space = input.prepare(std::max<size_t>(BUFFER_SIZE, endpoint.recordSize()));
+            int bytesReceived = recv(clientSocket, space, static_cast<int>(input.writable()), 0);
+            if (bytesReceived <= 0) {
+                break;
+            }
+            input.commit(static_cast<size_t>(bytesReceived));
+        }
+
+        if (status == FrameParser::Status::Complete && reply.type == FrameType::Stats) {
+            std::cout << reply.payload;
+        } else if (status == FrameParser::Status::Complete) {
+            std::cout << "Client: " << reply.payload << std::endl;
         } else {
             std::cout << "Client: Server disconnected" << std::endl;
             break;
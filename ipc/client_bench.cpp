@@ -0,0 +1,375 @@
+// client_bench.cpp : Load generator for the Server. Opens many connections
+// spread over a few epoll threads and drives them with framed echo requests,
+// either closed-loop (a fixed number of requests in flight per connection)
+// or open-loop (requests sent on a fixed schedule whatever the replies do).
+// Reports throughput and the latency distribution.
+//
+// Open-loop latency is measured from when each request was due rather than
+// when it was sent, so a stalled server shows up in the tail instead of
+// silently slowing the load down (coordinated omission).
+
+#include "net.h"
+#include "protocol.h"
+#include "histogram.h"
+#include "transport.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    Endpoint endpoint;
+    int connections = 100;
+    int threads = 0;           // 0: one per core
+    size_t messageSize = 64;
+    int depth = 1;             // Requests in flight per connection (closed loop)
+    double rate = 0;           // Total requests/s; 0 for closed loop
+    double seconds = 5;
+    double warmupSeconds = 1;
+};
+
+struct BenchConnection {
+    SOCKET socket = INVALID_SOCKET;
+    FrameParser input;
+    std::string output;                       // Requests not yet sent
+    size_t outputOffset = 0;
+    std::deque<Clock::time_point> inFlight;   // Start time of each request awaiting its reply
+    Clock::time_point nextSend;               // Open loop: when the next request is due
+    bool failed = false;
+};
+
+struct WorkerResult {
+    LatencyHistogram latencyNs;
+    uint64_t completed = 0;   // Replies in the measured window
+    uint64_t errors = 0;
+    uint64_t connectFailures = 0;
+};
+
+class Worker {
+public:
+    Worker(const Options& options, int connections, const std::string& request)
+        : m_options(options), m_request(request), m_connections(connections)
+        , m_recordSize(options.endpoint.recordSize()) {
+        m_epoll = epoll_create1(EPOLL_CLOEXEC);
+        if (options.rate > 0) {
+            m_interval = std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(options.connections / options.rate));
+        }
+    }
+
+    ~Worker() {
+        for (auto& connection : m_connections) {
+            if (connection.socket != INVALID_SOCKET) {
+                closesocket(connection.socket);
+            }
+        }
+        close(m_epoll);
+    }
+
+    Worker(const Worker&) = delete;
+    Worker& operator=(const Worker&) = delete;
+
+    void connectAll() {
+        for (auto& connection : m_connections) {
+            std::string error;
+            SOCKET socket = connectTo(m_options.endpoint, error);
+            if (socket == INVALID_SOCKET) {
+                ++m_result.connectFailures;
+                connection.failed = true;
+                continue;
+            }
+            if (m_options.endpoint.transport == Transport::Tcp) {
+                int noDelay = 1;
+                setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+            }
+            setNonBlocking(socket);
+            connection.socket = socket;
+
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+            event.data.ptr = &connection;
+            epoll_ctl(m_epoll, EPOLL_CTL_ADD, socket, &event);
+        }
+    }
+
+    void run(Clock::time_point start, Clock::time_point measureFrom, Clock::time_point end) {
+        m_measureFrom = measureFrom;
+        // Stagger open-loop schedules so connections don't fire in lockstep
+        size_t index = 0;
+        for (auto& connection : m_connections) {
+            connection.nextSend = start + m_interval * index++ / m_connections.size();
+            if (m_interval == Clock::duration::zero() && !connection.failed) {
+                for (int i = 0; i < m_options.depth; ++i) {
+                    queueRequest(connection, Clock::now());
+                }
+                flush(connection);
+            }
+        }
+
+        epoll_event events[256];
+        while (Clock::now() < end) {
+            int timeoutMs = m_interval == Clock::duration::zero() ? 100 : 1;
+            int count = epoll_wait(m_epoll, events, 256, timeoutMs);
+            for (int i = 0; i < count; ++i) {
+                auto& connection = *static_cast<BenchConnection*>(events[i].data.ptr);
+                if (connection.failed) {
+                    continue;
+                }
+                if (events[i].events & EPOLLOUT) {
+                    flush(connection);
+                }
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    onReadable(connection);
+                }
+            }
+            if (m_interval != Clock::duration::zero()) {
+                sendDue(Clock::now());
+            }
+        }
+    }
+
+    const WorkerResult& result() const { return m_result; }
+
+private:
+    void queueRequest(BenchConnection& connection, Clock::time_point due) {
+        connection.output += m_request;
+        connection.inFlight.push_back(due);
+    }
+
+    // Open loop: send every request whose time has come
+    void sendDue(Clock::time_point now) {
+        for (auto& connection : m_connections) {
+            if (connection.failed || connection.nextSend > now) {
+                continue;
+            }
+            while (connection.nextSend <= now) {
+                queueRequest(connection, connection.nextSend);
+                connection.nextSend += m_interval;
+            }
+            flush(connection);
+        }
+    }
+
+    void flush(BenchConnection& connection) {
+        while (connection.outputOffset < connection.output.size()) {
+            size_t length = connection.output.size() - connection.outputOffset;
+            if (m_recordSize != 0) {
+                length = std::min(length, m_recordSize);
+            }
+            ssize_t sent = send(connection.socket, connection.output.data() + connection.outputOffset,
+                length, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    return;  // EPOLLOUT resumes it
+                }
+                if (errno == EINTR) {
+                    continue;
+                }
+                fail(connection);
+                return;
+            }
+            connection.outputOffset += static_cast<size_t>(sent);
+        }
+        connection.output.clear();
+        connection.outputOffset = 0;
+    }
+
+    void onReadable(BenchConnection& connection) {
+        for (;;) {
+            char* space = connection.input.prepare(std::max<size_t>(BUFFER_SIZE * 16, m_recordSize));
+            ssize_t received = recv(connection.socket, space, connection.input.writable(), 0);
+            if (received == 0) {
+                fail(connection);
+                return;
+            }
+            if (received < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    fail(connection);
+                }
+                return;
+            }
+            connection.input.commit(static_cast<size_t>(received));
+
+            Clock::time_point now = Clock::now();
+            Frame frame;
+            FrameParser::Status status;
+            while ((status = connection.input.next(frame)) == FrameParser::Status::Complete) {
+                if (frame.type != FrameType::Reply || connection.inFlight.empty()) {
+                    fail(connection);
+                    return;
+                }
+                Clock::time_point started = connection.inFlight.front();
+                connection.inFlight.pop_front();
+                if (started >= m_measureFrom) {
+                    m_result.latencyNs.record(static_cast<uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(now - started).count()));
+                    ++m_result.completed;
+                }
+                if (m_interval == Clock::duration::zero()) {
+                    queueRequest(connection, now);
+                }
+            }
+            if (status == FrameParser::Status::Invalid) {
+                fail(connection);
+                return;
+            }
+            flush(connection);
+        }
+    }
+
+    void fail(BenchConnection& connection) {
+        ++m_result.errors;
+        connection.failed = true;
+        epoll_ctl(m_epoll, EPOLL_CTL_DEL, connection.socket, nullptr);
+    }
+
+    const Options& m_options;
+    const std::string& m_request;
+    std::vector<BenchConnection> m_connections;
+    size_t m_recordSize;  // Seqpacket: largest send or recv, else 0
+    int m_epoll;
+    Clock::duration m_interval{};  // Open loop: gap between one connection's requests
+    Clock::time_point m_measureFrom;
+    WorkerResult m_result;
+};
+
+// Thousands of connections need more descriptors than the usual soft
+// limit of 1024
+void raiseDescriptorLimit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+void printUsage(const char* program) {
+    std::fprintf(stderr,
+        "Usage: %s [--connect=tcp:[HOST:]PORT|unix:PATH|seqpacket:PATH] [--host=ADDR] [--port=N]\n"
+        "       [--connections=N] [--threads=N] [--size=BYTES]\n"
+        "       [--depth=N] [--rate=REQUESTS_PER_SECOND] [--duration=SECONDS] [--warmup=SECONDS]\n"
+        "Closed loop with --depth requests in flight per connection, or open loop at --rate.\n",
+        program);
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&](const char* name) -> const char* {
+            size_t length = std::strlen(name);
+            return arg.compare(0, length, name) == 0 ? arg.c_str() + length : nullptr;
+        };
+        if (const char* v = value("--connect=")) {
+            std::string error;
+            if (!parseEndpoint(v, options.endpoint, error)) {
+                std::fprintf(stderr, "%s\n", error.c_str());
+                return 1;
+            }
+        } else if (const char* v = value("--host=")) {
+            options.endpoint.host = v;
+        } else if (const char* v = value("--port=")) {
+            options.endpoint.port = std::atoi(v);
+        } else if (const char* v = value("--connections=")) {
+            options.connections = std::max(1, std::atoi(v));
+        } else if (const char* v = value("--threads=")) {
+            options.threads = std::max(1, std::atoi(v));
+        } else if (const char* v = value("--size=")) {
+            options.messageSize = static_cast<size_t>(std::max(1, std::atoi(v)));
+        } else if (const char* v = value("--depth=")) {
+            options.depth = std::max(1, std::atoi(v));
+        } else if (const char* v = value("--rate=")) {
+            options.rate = std::max(0.0, std::atof(v));
+        } else if (const char* v = value("--duration=")) {
+            options.seconds = std::max(0.1, std::atof(v));
+        } else if (const char* v = value("--warmup=")) {
+            options.warmupSeconds = std::max(0.0, std::atof(v));
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.messageSize > MAX_FRAME_PAYLOAD / 2) {
+        std::fprintf(stderr, "Message size must be at most %u bytes\n", MAX_FRAME_PAYLOAD / 2);
+        return 1;
+    }
+    if (options.threads == 0) {
+        options.threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    options.threads = std::min(options.threads, options.connections);
+    raiseDescriptorLimit();
+
+    std::string request;
+    appendFrame(request, FrameType::Message, std::string(options.messageSize, 'x'));
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (int i = 0; i < options.threads; ++i) {
+        int share = options.connections / options.threads + (i < options.connections % options.threads ? 1 : 0);
+        workers.push_back(std::make_unique<Worker>(options, share, request));
+    }
+    {
+        std::vector<std::thread> connecting;
+        for (auto& worker : workers) {
+            connecting.emplace_back([&worker] { worker->connectAll(); });
+        }
+        for (auto& thread : connecting) {
+            thread.join();
+        }
+    }
+
+    auto start = Clock::now();
+    auto measureFrom = start + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(options.warmupSeconds));
+    auto end = measureFrom + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(options.seconds));
+    std::vector<std::thread> threads;
+    for (auto& worker : workers) {
+        threads.emplace_back([&worker, start, measureFrom, end] { worker->run(start, measureFrom, end); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    WorkerResult total;
+    for (auto& worker : workers) {
+        const WorkerResult& result = worker->result();
+        total.latencyNs.merge(result.latencyNs);
+        total.completed += result.completed;
+        total.errors += result.errors;
+        total.connectFailures += result.connectFailures;
+    }
+
+    std::printf("%d connections over %d threads to %s, %zu byte messages, ", options.connections,
+        options.threads, options.endpoint.describe().c_str(), options.messageSize);
+    if (options.rate > 0) {
+        std::printf("open loop at %.0f req/s", options.rate);
+    } else {
+        std::printf("closed loop, depth %d", options.depth);
+    }
+    std::printf(", %.1f s (+%.1f s warmup)\n", options.seconds, options.warmupSeconds);
+    std::printf("requests %llu  throughput %.0f req/s  errors %llu  connect failures %llu\n",
+        static_cast<unsigned long long>(total.completed), total.completed / options.seconds,
+        static_cast<unsigned long long>(total.errors), static_cast<unsigned long long>(total.connectFailures));
+
+    const LatencyHistogram& latency = total.latencyNs;
+    auto us = [](uint64_t ns) { return ns / 1000.0; };
+    std::printf("latency us  min %.1f  mean %.1f  p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+        us(latency.min()), latency.mean() / 1000.0, us(latency.percentile(0.50)), us(latency.percentile(0.90)),
+        us(latency.percentile(0.99)), us(latency.percentile(0.999)), us(latency.max()));
+    return total.errors != 0 || total.connectFailures != 0 ? 1 : 0;
+}
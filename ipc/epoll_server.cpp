@@ -0,0 +1,519 @@
+// epoll_server.cpp : Reactor mode for the Server. An acceptor thread hands
+// new sockets to a fixed set of reactor threads (or, with reusePort, each
+// reactor accepts on its own listener); each reactor owns its connections
+// and drives them as small non-blocking state machines.
+
+#include "epoll_server.h"
+#include "server_common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int MAX_EVENTS = 256;
+constexpr size_t MAX_PENDING_OUTPUT = 64 * 1024;  // Stop reading a client above this
+
+struct Connection {
+    SOCKET socket;
+    int clientId;
+    FrameParser input;             // Received bytes, parsed into frames in place
+    OutputBuffer output;           // Replies not yet sent
+    bool readPaused = false;       // Unread input left in the kernel until output drains
+    bool closeAfterFlush = false;  // Client sent quit
+    Clock::time_point lastActive;
+    Clock::time_point replyStart;  // When the oldest unsent reply's request was read
+    ConnectionStats stats;
+};
+
+// epoll tag of a reactor's own listening socket
+char listenTag;
+
+class Reactor {
+public:
+    Reactor(const ReactorConfig& config, std::atomic<int>& clientCount, int index)
+        : m_config(config), m_clientCount(clientCount), m_index(index)
+        , m_recordSize(config.endpoint.recordSize()) {
+        m_epoll = epoll_create1(EPOLL_CLOEXEC);
+        m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (m_epoll == -1 || m_wakeFd == -1) {
+            throw std::system_error(errno, std::generic_category(), "Failed to create reactor");
+        }
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr;  // nullptr marks the wake-up eventfd
+        epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeFd, &event);
+    }
+
+    ~Reactor() {
+        for (auto& entry : m_connections) {
+            closesocket(entry.second->socket);
+        }
+        for (auto& pending : m_handoff) {
+            closesocket(pending.first);
+        }
+        if (m_ownsListener) {
+            ServerStats::instance().unwatchListener(m_listenSocket);
+            closesocket(m_listenSocket);
+        }
+        close(m_wakeFd);
+        close(m_epoll);
+    }
+
+    // Accept on this reactor's own listener (reusePort mode). peers are all
+    // the reactors sharing maxConnections, woken when a slot frees up.
+    void listenOn(SOCKET listenSocket, bool owned, const std::vector<std::unique_ptr<Reactor>>& peers) {
+        m_listenSocket = listenSocket;
+        m_ownsListener = owned;
+        m_peers = &peers;
+        if (owned) {
+            ServerStats::instance().watchListener(listenSocket);
+        }
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLET;
+        event.data.ptr = &listenTag;
+        if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, listenSocket, &event) == -1) {
+            throw std::system_error(errno, std::generic_category(), "Failed to watch listener");
+        }
+    }
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    // Called by the acceptor thread
+    void adopt(SOCKET socket, int clientId) {
+        {
+            std::lock_guard<std::mutex> lock(m_handoffMutex);
+            m_handoff.emplace_back(socket, clientId);
+        }
+        uint64_t one = 1;
+        ssize_t written = write(m_wakeFd, &one, sizeof(one));
+        (void)written;
+    }
+
+    // Called by other reactors: retry accepting if this one stopped at the
+    // connection limit
+    void resumeAccepting() {
+        if (m_acceptPaused) {
+            uint64_t one = 1;
+            ssize_t written = write(m_wakeFd, &one, sizeof(one));
+            (void)written;
+        }
+    }
+
+    void run(const std::atomic<bool>& running) {
+        m_stats = &threadStats();
+        epoll_event events[MAX_EVENTS];
+        auto nextSweep = Clock::now() + std::chrono::seconds(1);
+        while (running) {
+            int count = epoll_wait(m_epoll, events, MAX_EVENTS, 1000);
+            if (count == -1 && errno != EINTR) {
+                logError("Server: epoll_wait failed: ", strerror(errno));
+                break;
+            }
+            for (int i = 0; i < count; ++i) {
+                auto* connection = static_cast<Connection*>(events[i].data.ptr);
+                if (connection == nullptr) {
+                    adoptPending();
+                    continue;
+                }
+                if (events[i].data.ptr == &listenTag) {
+                    acceptPending();
+                    continue;
+                }
+                if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                    // Still read first so a final message and EOF are handled
+                    events[i].events |= EPOLLIN;
+                }
+                if ((events[i].events & EPOLLOUT) && !flush(*connection)) {
+                    continue;
+                }
+                if ((events[i].events & EPOLLIN) && !connection->readPaused) {
+                    onReadable(*connection);
+                }
+            }
+            if (Clock::now() >= nextSweep) {
+                closeIdle();
+                nextSweep = Clock::now() + std::chrono::seconds(1);
+            }
+        }
+    }
+
+private:
+    void adoptPending() {
+        uint64_t value;
+        ssize_t drained = read(m_wakeFd, &value, sizeof(value));
+        (void)drained;
+
+        std::vector<std::pair<SOCKET, int>> pending;
+        {
+            std::lock_guard<std::mutex> lock(m_handoffMutex);
+            pending.swap(m_handoff);
+        }
+        for (auto& [socket, clientId] : pending) {
+            addConnection(socket, clientId);
+        }
+        if (m_acceptPaused) {
+            acceptPending();
+        }
+    }
+
+    // Accept until EAGAIN or maxConnections across all reactors. At the
+    // limit new connections wait in the listen backlog until one closes.
+    void acceptPending() {
+        bool wasPaused = m_acceptPaused;
+        m_acceptPaused = false;
+        while (true) {
+            // Reserve the slot first so concurrent reactors can't overshoot
+            if (m_clientCount.fetch_add(1) >= m_config.maxConnections) {
+                --m_clientCount;
+                break;
+            }
+            SOCKET clientSocket = accept4(m_listenSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (clientSocket == INVALID_SOCKET) {
+                int error = errno;
+                releaseSlot();
+                if (error == EINTR) {
+                    continue;
+                }
+                if (error == EMFILE || error == ENFILE) {
+                    // Out of descriptors; retry once a connection closes
+                    logError("Server: Accept failed. Error: ", strerror(error));
+                    break;
+                }
+                if (error != EAGAIN && error != EWOULDBLOCK) {
+                    logError("Server: Accept failed. Error: ", strerror(error));
+                }
+                return;
+            }
+            // Ids are unique without sharing a counter between reactors
+            int clientId = m_index + 1 + m_accepted++ * m_config.threads;
+            addConnection(clientSocket, clientId);
+        }
+        if (!wasPaused) {
+            ServerStats::instance().acceptPaused();
+        }
+        m_acceptPaused = true;
+    }
+
+    void addConnection(SOCKET socket, int clientId) {
+        auto connection = std::make_unique<Connection>();
+        connection->socket = socket;
+        connection->clientId = clientId;
+        connection->lastActive = Clock::now();
+
+        // Registered once for both directions; edge-triggered, so each
+        // event means "try again until EAGAIN"
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.ptr = connection.get();
+        if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, socket, &event) == -1) {
+            logError("Server: Failed to register client #", clientId, ": ", strerror(errno));
+            closesocket(socket);
+            releaseSlot();
+            return;
+        }
+        m_stats->accepted();
+        logInfo("Server: Client #", clientId, " connected! (Total clients: ", m_clientCount, ")");
+        m_connections.emplace(socket, std::move(connection));
+    }
+
+    // Read until EAGAIN, answering each complete frame. Returns false if
+    // the connection was closed.
+    bool onReadable(Connection& connection) {
+        for (;;) {
+            if (connection.output.size() > MAX_PENDING_OUTPUT) {
+                // Client isn't reading its replies; leave the rest in the
+                // kernel (TCP backpressure) until the output drains
+                connection.readPaused = true;
+                m_stats->backpressure();
+                return true;
+            }
+
+            char* space = connection.input.prepare(std::max<size_t>(BUFFER_SIZE, m_recordSize));
+            ssize_t bytesReceived = recv(connection.socket, space, connection.input.writable(), 0);
+            if (bytesReceived == 0) {
+                return closeConnection(connection, "closed connection gracefully");
+            }
+            if (bytesReceived < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    return true;
+                }
+                if (errno == EINTR) {
+                    continue;
+                }
+                return closeConnection(connection, errno == ECONNRESET
+                    ? "connection reset by peer" : "receive error");
+            }
+            connection.input.commit(static_cast<size_t>(bytesReceived));
+            connection.lastActive = Clock::now();
+            m_stats->received(connection.stats, static_cast<size_t>(bytesReceived));
+            if (connection.output.empty()) {
+                connection.replyStart = connection.lastActive;
+            }
+
+            Frame frame;
+            FrameParser::Status status;
+            while ((status = connection.input.next(frame)) == FrameParser::Status::Complete) {
+                MessageResult result = handleMessage(connection.clientId, frame, connection.output, connection.stats);
+                if (result == MessageResult::Quit) {
+                    connection.closeAfterFlush = true;
+                    connection.readPaused = true;  // Nothing after quit is read
+                    if (!flush(connection)) {
+                        return false;
+                    }
+                    connection.output.detach();
+                    return true;
+                }
+            }
+            if (status == FrameParser::Status::Invalid) {
+                return closeConnection(connection, "sent a malformed frame");
+            }
+            // One gathered send for all the replies; what the socket
+            // doesn't take must stop referencing the input buffer
+            if (!flush(connection)) {
+                return false;
+            }
+            connection.output.detach();
+        }
+    }
+
+    // Send pending output. Returns false if the connection was closed.
+    bool flush(Connection& connection) {
+        bool wrote = false;
+        while (!connection.output.empty()) {
+            long sent = connection.output.flushTo(connection.socket, m_recordSize);
+            if (sent == SOCKET_ERROR) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    return true;  // EPOLLOUT resumes it
+                }
+                if (errno == EINTR) {
+                    continue;
+                }
+                return closeConnection(connection, "send error");
+            }
+            m_stats->sent(connection.stats, static_cast<size_t>(sent));
+            wrote = true;
+        }
+        if (wrote) {
+            m_stats->latency(Clock::now() - connection.replyStart);
+        }
+
+        if (connection.closeAfterFlush) {
+            return closeConnection(connection, "disconnected");
+        }
+        if (connection.readPaused) {
+            connection.readPaused = false;
+            return onReadable(connection);
+        }
+        return true;
+    }
+
+    bool closeConnection(Connection& connection, const char* reason) {
+        int clientId = connection.clientId;
+        SOCKET socket = connection.socket;
+        m_stats->closed();
+        logConnectionStats(clientId, connection.stats);
+        closesocket(socket);
+        m_connections.erase(socket);  // Destroys connection
+        releaseSlot();
+        logInfo("Server: Client #", clientId, " ", reason,
+            " (Remaining clients: ", m_clientCount, ")");
+        if (m_acceptPaused) {
+            acceptPending();
+        }
+        return false;
+    }
+
+    // Give back a connection slot. Reactors that stopped at the limit may
+    // have connections waiting in their own listener's backlog.
+    void releaseSlot() {
+        if (m_clientCount.fetch_sub(1) < m_config.maxConnections || m_peers == nullptr) {
+            return;
+        }
+        for (auto& peer : *m_peers) {
+            if (peer.get() != this) {
+                peer->resumeAccepting();
+            }
+        }
+    }
+
+    void closeIdle() {
+        auto deadline = Clock::now() - std::chrono::seconds(m_config.idleTimeoutSeconds);
+        std::vector<Connection*> idle;
+        for (auto& entry : m_connections) {
+            if (entry.second->lastActive < deadline) {
+                idle.push_back(entry.second.get());
+            }
+        }
+        for (Connection* connection : idle) {
+            closeConnection(*connection, "connection timed out");
+        }
+    }
+
+    const ReactorConfig& m_config;
+    std::atomic<int>& m_clientCount;
+    int m_index;
+    size_t m_recordSize;  // Seqpacket: largest send or recv, else 0
+    StatsSlot* m_stats = nullptr;  // The reactor thread's, set by run()
+    int m_epoll;
+    int m_wakeFd;
+    SOCKET m_listenSocket = INVALID_SOCKET;
+    bool m_ownsListener = false;
+    const std::vector<std::unique_ptr<Reactor>>* m_peers = nullptr;
+    std::atomic<bool> m_acceptPaused{false};  // Read by peers in resumeAccepting
+    int m_accepted = 0;
+    std::mutex m_handoffMutex;
+    std::vector<std::pair<SOCKET, int>> m_handoff;
+    std::unordered_map<SOCKET, std::unique_ptr<Connection>> m_connections;
+};
+
+// Tens of thousands of connections need more descriptors than the usual
+// soft limit of 1024
+void raiseDescriptorLimit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+// Another listener on the same port; SO_REUSEPORT lets the kernel balance
+// incoming connections across all of them
+SOCKET createReusePortListener(const Endpoint& endpoint) {
+    std::string error;
+    SOCKET listener = listenOn(endpoint, true, error);
+    if (listener == INVALID_SOCKET) {
+        throw std::runtime_error("Failed to listen with SO_REUSEPORT: " + error);
+    }
+    setNonBlocking(listener);
+    return listener;
+}
+
+void pinToCore(std::thread& thread, int index) {
+    int cores = static_cast<int>(std::thread::hardware_concurrency());
+    if (cores <= 0) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(index % cores, &set);
+    int result = pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+    if (result != 0) {
+        logWarning("Server: Failed to pin reactor ", index, ": ", strerror(result));
+    }
+}
+
+} // namespace
+
+int runEpollServer(SOCKET listenSocket, const ReactorConfig& config,
+                   std::atomic<int>& clientCount, const std::atomic<bool>& running) {
+    raiseDescriptorLimit();
+
+    if (!setNonBlocking(listenSocket)) {
+        std::cerr << "Server: Failed to make listening socket non-blocking: " << socketErrorString() << std::endl;
+        return 1;
+    }
+    int acceptEpoll = -1;
+    if (!config.reusePort) {
+        acceptEpoll = epoll_create1(EPOLL_CLOEXEC);
+        epoll_event listenEvent{};
+        listenEvent.events = EPOLLIN | EPOLLET;
+        if (acceptEpoll == -1 || epoll_ctl(acceptEpoll, EPOLL_CTL_ADD, listenSocket, &listenEvent) == -1) {
+            std::cerr << "Server: Failed to create acceptor: " << strerror(errno) << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<std::unique_ptr<Reactor>> reactors;
+    try {
+        for (int i = 0; i < config.threads; ++i) {
+            reactors.push_back(std::make_unique<Reactor>(config, clientCount, i));
+            if (config.reusePort) {
+                // Reactor 0 takes the caller's listener, the rest open their own
+                bool first = i == 0;
+                reactors.back()->listenOn(first ? listenSocket : createReusePortListener(config.endpoint), !first, reactors);
+            }
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Server: Failed to start reactors: " << ex.what() << std::endl;
+        if (acceptEpoll != -1) {
+            close(acceptEpoll);
+        }
+        return 1;
+    }
+
+    ServerStats::instance().watchListener(listenSocket);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < reactors.size(); ++i) {
+        Reactor* reactor = reactors[i].get();
+        threads.emplace_back([reactor, &running] { reactor->run(running); });
+        if (config.pinThreads) {
+            pinToCore(threads.back(), static_cast<int>(i));
+        }
+    }
+    std::cout << "Server: epoll mode with " << config.threads << " reactor threads"
+              << (config.reusePort ? " (SO_REUSEPORT)" : "") << std::endl;
+
+    if (config.reusePort) {
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        ServerStats::instance().unwatchListener(listenSocket);
+        return 0;
+    }
+
+    // Accept loop. The timeout lets it notice shutdown and retry after the
+    // connection limit or EMFILE made it leave connections in the backlog.
+    int nextClientId = 1;
+    size_t nextReactor = 0;
+    bool atLimit = false;
+    while (running) {
+        epoll_event event;
+        epoll_wait(acceptEpoll, &event, 1, 100);
+
+        if (clientCount >= config.maxConnections) {
+            if (!atLimit) {
+                ServerStats::instance().acceptPaused();
+            }
+            atLimit = true;
+            continue;
+        }
+        atLimit = false;
+        while (running && clientCount < config.maxConnections) {
+            SOCKET clientSocket = accept4(listenSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (clientSocket == INVALID_SOCKET) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    logError("Server: Accept failed. Error: ", strerror(errno));
+                }
+                break;
+            }
+            ++clientCount;
+            reactors[nextReactor]->adopt(clientSocket, nextClientId++);
+            nextReactor = (nextReactor + 1) % reactors.size();
+        }
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ServerStats::instance().unwatchListener(listenSocket);
+    close(acceptEpoll);
+    return 0;
+}
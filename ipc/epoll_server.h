@@ -0,0 +1,24 @@
+#pragma once
+
+// Edge-triggered epoll reactor mode for the Server (Linux)
+
+#include "transport.h"
+#include <atomic>
+
+struct ReactorConfig {
+    int threads = 4;                 // Reactor threads
+    int maxConnections = 65536;      // Stop accepting above this
+    int idleTimeoutSeconds = 30;     // Close connections idle this long
+    Endpoint endpoint;               // What the listening socket is bound to
+
+    // Every reactor accepts on its own SO_REUSEPORT listener and owns its
+    // connections end to end; the kernel spreads new connections across them.
+    // The listening socket passed to runEpollServer must have SO_REUSEPORT set.
+    bool reusePort = false;
+    bool pinThreads = false;         // Pin reactor i to core i
+};
+
+// Serve clients on listenSocket until running becomes false. Returns the
+// process exit code.
+int runEpollServer(SOCKET listenSocket, const ReactorConfig& config,
+                   std::atomic<int>& clientCount, const std::atomic<bool>& running);
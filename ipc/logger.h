@@ -0,0 +1,284 @@
+#pragma once
+
+// Asynchronous logger for the Server. Each thread formats its lines into a
+// lock-free ring of its own and returns straight away; a background writer
+// drains every ring and does the terminal I/O. A full ring drops the line
+// (counted and reported) rather than stalling the caller.
+//
+// Levels below IPC_LOG_LEVEL compile out entirely; setLogLevel() raises the
+// threshold further at run time.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+enum class LogLevel : int {
+    Debug = 0,
+    Info = 1,
+    Warning = 2,
+    Error = 3
+};
+
+#ifndef IPC_LOG_LEVEL
+#define IPC_LOG_LEVEL 1
+#endif
+constexpr LogLevel COMPILED_LOG_LEVEL = static_cast<LogLevel>(IPC_LOG_LEVEL);
+
+// One formatted line; longer lines are truncated
+struct LogRecord {
+    LogLevel level;
+    uint16_t length;
+    char text[250];
+};
+
+// Single-producer single-consumer ring owned by one logging thread
+class LogQueue {
+public:
+    static constexpr size_t CAPACITY = 256;  // Records (power of two)
+
+    // Slot for the next record, or nullptr (and a drop counted) when full
+    LogRecord* beginWrite() {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == CAPACITY) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &m_records[tail & (CAPACITY - 1)];
+    }
+
+    void commitWrite() {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Writer side: hand each queued record to sink. Returns the count.
+    template<typename Sink>
+    size_t drain(Sink&& sink) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        size_t tail = m_tail.load(std::memory_order_acquire);
+        for (size_t i = head; i != tail; ++i) {
+            sink(m_records[i & (CAPACITY - 1)]);
+        }
+        m_head.store(tail, std::memory_order_release);
+        return tail - head;
+    }
+
+    bool empty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    uint64_t takeDropped() { return m_dropped.exchange(0, std::memory_order_relaxed); }
+
+    // The owning thread exited; the writer frees the queue once it is empty
+    void abandon() { m_abandoned.store(true, std::memory_order_release); }
+    bool abandoned() const { return m_abandoned.load(std::memory_order_acquire); }
+
+private:
+    std::array<LogRecord, CAPACITY> m_records;
+    alignas(64) std::atomic<size_t> m_head{ 0 };  // Written by the writer
+    alignas(64) std::atomic<size_t> m_tail{ 0 };  // Written by the owner
+    std::atomic<uint64_t> m_dropped{ 0 };
+    std::atomic<bool> m_abandoned{ false };
+};
+
+// Formats arguments into a record's text without allocating
+class LogLine {
+public:
+    LogLine(char* begin, size_t capacity) : m_begin(begin), m_cursor(begin), m_end(begin + capacity) {}
+
+    void put(std::string_view text) {
+        size_t room = static_cast<size_t>(m_end - m_cursor);
+        if (text.size() > room) {
+            // Truncate, marking the cut with "..."
+            text = text.substr(0, room);
+            m_truncated = true;
+        }
+        std::memcpy(m_cursor, text.data(), text.size());
+        m_cursor += text.size();
+    }
+
+    void put(const char* text) { put(std::string_view(text != nullptr ? text : "(null)")); }
+
+    void put(bool value) { put(std::string_view(value ? "true" : "false")); }
+
+    template<typename T, typename = std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+    void put(T value) {
+        auto result = std::to_chars(m_cursor, m_end, value);
+        if (result.ec == std::errc()) {
+            m_cursor = result.ptr;
+        } else {
+            m_truncated = true;
+        }
+    }
+
+    void put(double value) {
+        char buffer[32];
+        int length = std::snprintf(buffer, sizeof(buffer), "%g", value);
+        put(std::string_view(buffer, static_cast<size_t>(length)));
+    }
+
+    template<typename T>
+    void put(const std::atomic<T>& value) { put(value.load(std::memory_order_relaxed)); }
+
+    size_t finish() {
+        if (m_truncated && m_end - m_begin >= 3) {
+            std::memcpy(m_end - 3, "...", 3);
+            m_cursor = m_end;
+        }
+        return static_cast<size_t>(m_cursor - m_begin);
+    }
+
+private:
+    char* m_begin;
+    char* m_cursor;
+    char* m_end;
+    bool m_truncated = false;
+};
+
+class Logger {
+public:
+    static Logger& instance() {
+        static Logger logger;
+        return logger;
+    }
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    // Drains what is left before the process exits
+    ~Logger() {
+        m_running = false;
+        if (m_writer.joinable()) {
+            m_writer.join();
+        }
+    }
+
+    void setLevel(LogLevel level) { m_level.store(level, std::memory_order_relaxed); }
+    bool enabled(LogLevel level) const { return level >= m_level.load(std::memory_order_relaxed); }
+
+    template<typename... Args>
+    void write(LogLevel level, const Args&... args) {
+        LogQueue& queue = threadQueue();
+        LogRecord* record = queue.beginWrite();
+        if (record == nullptr) {
+            return;
+        }
+        LogLine line(record->text, sizeof(record->text));
+        (line.put(args), ...);
+        record->level = level;
+        record->length = static_cast<uint16_t>(line.finish());
+        queue.commitWrite();
+    }
+
+private:
+    // Owning handle of the calling thread's queue
+    struct ThreadQueue {
+        std::shared_ptr<LogQueue> queue;
+        ~ThreadQueue() {
+            if (queue) {
+                queue->abandon();
+            }
+        }
+    };
+
+    Logger() : m_writer([this] { run(); }) {}
+
+    LogQueue& threadQueue() {
+        thread_local ThreadQueue local;
+        if (!local.queue) {
+            // The only lock a logging thread takes, once
+            local.queue = std::make_shared<LogQueue>();
+            std::lock_guard<std::mutex> lock(m_queuesMutex);
+            m_queues.push_back(local.queue);
+        }
+        return *local.queue;
+    }
+
+    void run() {
+        std::vector<std::shared_ptr<LogQueue>> queues;
+        std::string out;
+        std::string err;
+        uint64_t dropped = 0;
+        for (;;) {
+            bool stopping = !m_running;
+            {
+                std::lock_guard<std::mutex> lock(m_queuesMutex);
+                queues = m_queues;
+            }
+
+            size_t drained = 0;
+            for (auto& queue : queues) {
+                drained += queue->drain([&](const LogRecord& record) {
+                    std::string& target = record.level >= LogLevel::Warning ? err : out;
+                    target.append(record.text, record.length);
+                    target += '\n';
+                });
+                dropped += queue->takeDropped();
+            }
+            if (dropped != 0) {
+                err += "Logger: dropped " + std::to_string(dropped) + " messages\n";
+                dropped = 0;
+            }
+            if (!out.empty()) {
+                std::fwrite(out.data(), 1, out.size(), stdout);
+                std::fflush(stdout);
+                out.clear();
+            }
+            if (!err.empty()) {
+                std::fwrite(err.data(), 1, err.size(), stderr);
+                err.clear();
+            }
+
+            {
+                // Forget queues whose thread exited once they are empty
+                std::lock_guard<std::mutex> lock(m_queuesMutex);
+                m_queues.erase(std::remove_if(m_queues.begin(), m_queues.end(),
+                    [](const std::shared_ptr<LogQueue>& queue) {
+                        return queue->abandoned() && queue->empty();
+                    }), m_queues.end());
+            }
+            queues.clear();
+
+            if (stopping) {
+                return;
+            }
+            if (drained == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+        }
+    }
+
+    std::atomic<bool> m_running{ true };
+    std::atomic<LogLevel> m_level{ COMPILED_LOG_LEVEL };
+    std::mutex m_queuesMutex;
+    std::vector<std::shared_ptr<LogQueue>> m_queues;
+    std::thread m_writer;  // Last, so it starts after the rest is constructed
+};
+
+template<LogLevel Level, typename... Args>
+void logAt(const Args&... args) {
+    if constexpr (Level >= COMPILED_LOG_LEVEL) {
+        Logger& logger = Logger::instance();
+        if (logger.enabled(Level)) {
+            logger.write(Level, args...);
+        }
+    }
+}
+
+template<typename... Args> void logDebug(const Args&... args) { logAt<LogLevel::Debug>(args...); }
+template<typename... Args> void logInfo(const Args&... args) { logAt<LogLevel::Info>(args...); }
+template<typename... Args> void logWarning(const Args&... args) { logAt<LogLevel::Warning>(args...); }
+template<typename... Args> void logError(const Args&... args) { logAt<LogLevel::Error>(args...); }
+
+// Raise the run-time threshold (levels below IPC_LOG_LEVEL stay compiled out)
+inline void setLogLevel(LogLevel level) { Logger::instance().setLevel(level); }
@@ -0,0 +1,68 @@
+#pragma once
+
+// Socket portability layer shared by the Server and Client
+
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#define SOCKET int
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+#define closesocket close
+#endif
+
+constexpr int PORT = 8080;
+constexpr int BUFFER_SIZE = 1024;
+
+inline void initializeSockets() {
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        std::cerr << "WSAStartup failed" << std::endl;
+        exit(1);
+    }
+#endif
+}
+
+inline void cleanupSockets() {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+// Description of the last socket error on this thread
+inline std::string socketErrorString() {
+#ifdef _WIN32
+    return std::to_string(WSAGetLastError());
+#else
+    return strerror(errno);
+#endif
+}
+
+// enable false switches the socket back to blocking
+inline bool setNonBlocking(SOCKET socket, bool enable = true) {
+#ifdef _WIN32
+    u_long mode = enable ? 1 : 0;
+    return ioctlsocket(socket, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    if (flags == -1) {
+        return false;
+    }
+    return fcntl(socket, F_SETFL, enable ? flags | O_NONBLOCK : flags & ~O_NONBLOCK) == 0;
+#endif
+}
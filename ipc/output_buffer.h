@@ -0,0 +1,165 @@
+#pragma once
+
+// Per-connection output queue. Replies to every request parsed from a read
+// are appended here and leave in one gathered send (sendmsg / WSASend), so
+// pipelined requests cost one syscall per batch rather than one per reply.
+
+#include "net.h"
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
+class OutputBuffer {
+public:
+    // Pieces at least this big are referenced rather than copied
+    static constexpr size_t REFERENCE_MIN = 512;
+
+    // Copy data into the buffer
+    void append(std::string_view data) {
+        if (data.empty()) {
+            return;
+        }
+        if (!m_segments.empty() && m_segments.back().owned
+            && m_segments.back().offset + m_segments.back().size == m_owned.size()) {
+            m_segments.back().size += data.size();
+        } else {
+            m_segments.push_back({ true, m_owned.size(), nullptr, data.size() });
+        }
+        m_owned.append(data.data(), data.size());
+        m_size += data.size();
+    }
+
+    // Queue data without copying it; it must stay valid until it is sent
+    // or detach() is called. Small pieces are copied anyway.
+    void appendReference(std::string_view data) {
+        if (data.size() < REFERENCE_MIN) {
+            append(data);
+            return;
+        }
+        m_segments.push_back({ false, 0, data.data(), data.size() });
+        m_size += data.size();
+    }
+
+    // Copy every referenced piece into the buffer, before the memory it
+    // points to is reused
+    void detach() {
+        for (Segment& segment : m_segments) {
+            if (!segment.owned) {
+                segment.offset = m_owned.size();
+                m_owned.append(segment.data, segment.size);
+                segment.owned = true;
+                segment.data = nullptr;
+            }
+        }
+    }
+
+    // Unsent bytes
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    // Send as much as the socket takes in one call, at most limit bytes
+    // when limit isn't 0 (a seqpacket socket's record size). Returns the
+    // bytes sent, or SOCKET_ERROR with the error left in errno /
+    // WSAGetLastError().
+    long flushTo(SOCKET socket, size_t limit = 0) {
+        constexpr size_t MAX_SEGMENTS = 64;
+        std::string_view pieces[MAX_SEGMENTS];
+        size_t count = 0;
+        size_t total = 0;
+        for (size_t i = m_head; i < m_segments.size() && count < MAX_SEGMENTS; ++i) {
+            std::string_view piece = unsent(i);
+            if (limit != 0 && total + piece.size() >= limit) {
+                pieces[count++] = piece.substr(0, limit - total);
+                break;
+            }
+            pieces[count++] = piece;
+            total += piece.size();
+        }
+#ifdef _WIN32
+        WSABUF buffers[MAX_SEGMENTS];
+        for (size_t i = 0; i < count; ++i) {
+            buffers[i].buf = const_cast<char*>(pieces[i].data());
+            buffers[i].len = static_cast<ULONG>(pieces[i].size());
+        }
+        DWORD sent = 0;
+        if (WSASend(socket, buffers, static_cast<DWORD>(count), &sent, 0, nullptr, nullptr) == SOCKET_ERROR) {
+            return SOCKET_ERROR;
+        }
+#else
+        iovec buffers[MAX_SEGMENTS];
+        for (size_t i = 0; i < count; ++i) {
+            buffers[i].iov_base = const_cast<char*>(pieces[i].data());
+            buffers[i].iov_len = pieces[i].size();
+        }
+        msghdr message{};
+        message.msg_iov = buffers;
+        message.msg_iovlen = count;
+        ssize_t sent = sendmsg(socket, &message, MSG_NOSIGNAL);
+        if (sent < 0) {
+            return SOCKET_ERROR;
+        }
+#endif
+        consume(static_cast<size_t>(sent));
+        return static_cast<long>(sent);
+    }
+
+    // Copy the unsent bytes to dest (size() bytes) and empty the buffer
+    void moveTo(char* dest) {
+        for (size_t i = m_head; i < m_segments.size(); ++i) {
+            std::string_view piece = unsent(i);
+            std::copy(piece.begin(), piece.end(), dest);
+            dest += piece.size();
+        }
+        clear();
+    }
+
+    void clear() {
+        m_segments.clear();
+        m_owned.clear();
+        m_head = 0;
+        m_headSent = 0;
+        m_size = 0;
+    }
+
+private:
+    struct Segment {
+        bool owned;
+        size_t offset;      // Into m_owned when owned
+        const char* data;   // Caller's memory otherwise
+        size_t size;
+    };
+
+    std::string_view unsent(size_t index) const {
+        const Segment& segment = m_segments[index];
+        const char* data = segment.owned ? m_owned.data() + segment.offset : segment.data;
+        size_t skip = index == m_head ? m_headSent : 0;
+        return std::string_view(data + skip, segment.size - skip);
+    }
+
+    void consume(size_t count) {
+        m_size -= count;
+        if (m_size == 0) {
+            clear();
+            return;
+        }
+        // Partial send: the next flush resumes mid-segment
+        count += m_headSent;
+        while (count >= m_segments[m_head].size) {
+            count -= m_segments[m_head].size;
+            ++m_head;
+        }
+        m_headSent = count;
+    }
+
+    std::vector<Segment> m_segments;
+    std::string m_owned;    // Storage of copied pieces
+    size_t m_head = 0;      // First segment with unsent bytes
+    size_t m_headSent = 0;  // Bytes of it already sent
+    size_t m_size = 0;
+};
@@ -0,0 +1,442 @@
+// pool_server.cpp : Thread pool mode for the Server. One dispatcher
+// thread owns the listener and every connection; it polls the idle ones and
+// passes a connection with input waiting to the worker pool, which reads
+// it, answers its complete frames and passes it back. Sockets are
+// non-blocking: replies a client doesn't take are kept, and the connection
+// is polled for writability rather than input until they are sent. Threads
+// never wait on a client, so a few workers serve any number of connections,
+// and at the connection limit the listener simply isn't polled: new
+// connections queue in the kernel backlog (TCP backpressure).
+
+#include "pool_server.h"
+#include "server_common.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int pollSockets(pollfd* fds, size_t count, int timeoutMs) {
+#ifdef _WIN32
+    return WSAPoll(fds, static_cast<ULONG>(count), timeoutMs);
+#else
+    return poll(fds, static_cast<nfds_t>(count), timeoutMs);
+#endif
+}
+
+bool wouldBlock() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+struct Connection {
+    SOCKET socket;
+    int clientId;
+    FrameParser input;              // Received bytes, parsed into frames in place
+    OutputBuffer output;            // Replies the socket hasn't taken yet
+    ConnectionStats stats;
+    Clock::time_point lastActive;
+    Clock::time_point replyStart;   // When the oldest unsent reply's request arrived
+    bool busy = false;              // With a worker; only the dispatcher reads it
+    const char* closeAfterFlush = nullptr;  // Reason to close once output is sent
+    const char* closeReason = nullptr;  // Set by the worker once the connection is done
+};
+
+// Send as much output as the socket takes. What it doesn't take stays for
+// the next time the connection is writable. Sets closeReason on failure or
+// once the last reply before a close went out.
+void flushOutput(Connection& connection, size_t recordSize, StatsSlot& slot) {
+    while (!connection.output.empty()) {
+        long sent = connection.output.flushTo(connection.socket, recordSize);
+        if (sent == SOCKET_ERROR) {
+            if (wouldBlock()) {
+                // Stop referencing the input buffer, which the next read reuses
+                connection.output.detach();
+                return;
+            }
+#ifndef _WIN32
+            if (errno == EINTR) {
+                continue;
+            }
+#endif
+            logError("Server: Client #", connection.clientId, " send error: ", socketErrorString());
+            connection.output.clear();
+            connection.closeReason = "send error";
+            return;
+        }
+        slot.sent(connection.stats, static_cast<size_t>(sent));
+    }
+    slot.latency(Clock::now() - connection.replyStart);
+    if (connection.closeAfterFlush != nullptr) {
+        connection.closeReason = connection.closeAfterFlush;
+    }
+}
+
+// Send the replies left over from last time if there are any, else read
+// what is waiting on a connection, answer every complete frame and send
+// the replies. Runs on a worker; sets closeReason if the connection is done.
+void serve(Connection& connection, size_t recordSize) {
+    StatsSlot& slot = threadStats();
+    int clientId = connection.clientId;
+
+    if (!connection.output.empty()) {
+        flushOutput(connection, recordSize, slot);
+        return;
+    }
+
+    char* space = connection.input.prepare(std::max<size_t>(BUFFER_SIZE, recordSize));
+    int bytesReceived = recv(connection.socket, space, static_cast<int>(connection.input.writable()), 0);
+    if (bytesReceived == 0) {
+        connection.closeReason = "closed connection gracefully";
+        return;
+    }
+    if (bytesReceived < 0) {
+        if (wouldBlock()) {
+            return;  // Nothing after all; back to the poll set
+        }
+#ifdef _WIN32
+        int error = WSAGetLastError();
+        if (error == WSAECONNRESET) {
+            connection.closeReason = "connection reset by peer";
+        } else {
+            logError("Server: Client #", clientId, " receive error: ", error);
+            connection.closeReason = "receive error";
+        }
+#else
+        if (errno == EINTR) {
+            return;
+        }
+        if (errno == ECONNRESET) {
+            connection.closeReason = "connection reset by peer";
+        } else {
+            logError("Server: Client #", clientId, " receive error: ", strerror(errno));
+            connection.closeReason = "receive error";
+        }
+#endif
+        return;
+    }
+    connection.input.commit(static_cast<size_t>(bytesReceived));
+    connection.lastActive = Clock::now();
+    connection.replyStart = connection.lastActive;
+    slot.received(connection.stats, static_cast<size_t>(bytesReceived));
+
+    Frame frame;
+    FrameParser::Status status;
+    while ((status = connection.input.next(frame)) == FrameParser::Status::Complete) {
+        if (handleMessage(clientId, frame, connection.output, connection.stats) == MessageResult::Quit) {
+            connection.closeAfterFlush = "disconnected";
+            break;
+        }
+    }
+    if (status == FrameParser::Status::Invalid) {
+        connection.closeAfterFlush = "sent a malformed frame";
+    }
+
+    if (!connection.output.empty()) {
+        flushOutput(connection, recordSize, slot);
+    } else if (connection.closeAfterFlush != nullptr) {
+        connection.closeReason = connection.closeAfterFlush;
+    }
+}
+
+class PoolServer {
+public:
+    PoolServer(SOCKET listenSocket, const PoolConfig& config, std::atomic<int>& clientCount)
+        : m_listenSocket(listenSocket), m_config(config), m_clientCount(clientCount)
+        , m_pool(config.workers) {
+        m_wakeSocket = createWakeSocket();
+    }
+
+    ~PoolServer() {
+        m_pool.drain();  // No worker may touch a connection once it is gone
+        for (auto& entry : m_connections) {
+            closesocket(entry.first);
+        }
+        closesocket(m_wakeSocket);
+    }
+
+    PoolServer(const PoolServer&) = delete;
+    PoolServer& operator=(const PoolServer&) = delete;
+
+    void run(const std::atomic<bool>& running) {
+        std::vector<pollfd> fds;
+        std::vector<Connection*> polled;
+        auto nextSweep = Clock::now() + std::chrono::seconds(1);
+        bool atLimit = false;
+        while (running) {
+            // Wake socket first, then the listener while below the limit,
+            // then every connection no worker has: for output if the client
+            // hasn't taken all its replies, else for input
+            fds.clear();
+            polled.clear();
+            fds.push_back({ m_wakeSocket, POLLIN, 0 });
+            bool accepting = m_clientCount < m_config.maxConnections;
+            if (!accepting && !atLimit) {
+                ServerStats::instance().acceptPaused();
+            }
+            atLimit = !accepting;
+            if (accepting) {
+                fds.push_back({ m_listenSocket, POLLIN, 0 });
+            }
+            size_t first = fds.size();
+            for (auto& entry : m_connections) {
+                if (!entry.second->busy) {
+                    fds.push_back({ entry.first, pollEvents(*entry.second), 0 });
+                    polled.push_back(entry.second.get());
+                }
+            }
+
+            // The timeout notices shutdown
+            if (pollSockets(fds.data(), fds.size(), 100) < 0) {
+#ifndef _WIN32
+                if (errno == EINTR) {
+                    continue;
+                }
+#endif
+                logError("Server: poll failed: ", socketErrorString());
+                break;
+            }
+
+            if (fds[0].revents != 0) {
+                drainWakeSocket();
+            }
+            collectReturned();
+            for (size_t i = 0; i < polled.size(); ++i) {
+                if (fds[first + i].revents != 0) {
+                    dispatch(*polled[i]);
+                }
+            }
+            if (accepting && fds[1].revents != 0) {
+                acceptPending();
+            }
+            if (Clock::now() >= nextSweep) {
+                closeIdle();
+                nextSweep = Clock::now() + std::chrono::seconds(1);
+            }
+        }
+        drain();
+    }
+
+private:
+    static short pollEvents(const Connection& connection) {
+        return connection.output.empty() ? POLLIN : POLLOUT;
+    }
+
+    // Loopback UDP socket connected to itself. Workers send it a byte to
+    // break the dispatcher out of poll(); it works with WSAPoll, which only
+    // takes sockets.
+    static SOCKET createWakeSocket() {
+        SOCKET wakeSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+        if (wakeSocket == INVALID_SOCKET
+            || bind(wakeSocket, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR
+            || getsockname(wakeSocket, (sockaddr*)&address, &length) == SOCKET_ERROR
+            || connect(wakeSocket, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR
+            || !setNonBlocking(wakeSocket)) {
+            std::string error = socketErrorString();
+            if (wakeSocket != INVALID_SOCKET) {
+                closesocket(wakeSocket);
+            }
+            throw std::runtime_error("Failed to create wake-up socket: " + error);
+        }
+        return wakeSocket;
+    }
+
+    void wake() {
+        if (!m_wakePending.exchange(true)) {
+            char byte = 0;
+            send(m_wakeSocket, &byte, 1, 0);
+        }
+    }
+
+    void drainWakeSocket() {
+        m_wakePending = false;
+        char buffer[64];
+        while (recv(m_wakeSocket, buffer, sizeof(buffer), 0) > 0) {
+        }
+    }
+
+    // Accept until the backlog is empty or the limit is reached
+    void acceptPending() {
+        while (m_clientCount < m_config.maxConnections) {
+            SOCKET clientSocket = accept(m_listenSocket, nullptr, nullptr);
+            if (clientSocket == INVALID_SOCKET) {
+                if (!wouldBlock()) {
+                    logError("Server: Accept failed. Error: ", socketErrorString());
+                }
+                return;
+            }
+            // Inherited from the listener on Windows but not on Linux
+            setNonBlocking(clientSocket);
+            auto connection = std::make_unique<Connection>();
+            connection->socket = clientSocket;
+            connection->clientId = m_nextClientId++;
+            connection->lastActive = Clock::now();
+            ++m_clientCount;
+            threadStats().accepted();
+            logInfo("Server: Client #", connection->clientId, " connected! (Total clients: ", m_clientCount, ")");
+            m_connections.emplace(clientSocket, std::move(connection));
+        }
+    }
+
+    void dispatch(Connection& connection) {
+        connection.busy = true;
+        size_t recordSize = m_config.recordSize;
+        m_pool.submit([this, &connection, recordSize] {
+            serve(connection, recordSize);
+            {
+                std::lock_guard<std::mutex> lock(m_returnedMutex);
+                m_returned.push_back(&connection);
+            }
+            wake();
+        });
+    }
+
+    // Take back connections the workers are done with
+    void collectReturned() {
+        std::vector<Connection*> returned;
+        {
+            std::lock_guard<std::mutex> lock(m_returnedMutex);
+            returned.swap(m_returned);
+        }
+        for (Connection* connection : returned) {
+            connection->busy = false;
+            if (connection->closeReason != nullptr) {
+                closeConnection(*connection, connection->closeReason);
+            }
+        }
+    }
+
+    void closeConnection(Connection& connection, const char* reason) {
+        int clientId = connection.clientId;
+        SOCKET socket = connection.socket;
+        threadStats().closed();
+        logConnectionStats(clientId, connection.stats);
+        closesocket(socket);
+        m_connections.erase(socket);  // Destroys connection
+        --m_clientCount;
+        logInfo("Server: Client #", clientId, " ", reason, " (Remaining clients: ", m_clientCount, ")");
+    }
+
+    void closeIdle() {
+        auto deadline = Clock::now() - std::chrono::seconds(m_config.idleTimeoutSeconds);
+        std::vector<Connection*> idle;
+        for (auto& entry : m_connections) {
+            if (!entry.second->busy && entry.second->lastActive < deadline) {
+                idle.push_back(entry.second.get());
+            }
+        }
+        for (Connection* connection : idle) {
+            closeConnection(*connection, "connection timed out");
+        }
+    }
+
+    // Shutting down: no more accepts, but requests that already arrived are
+    // answered before every connection is closed
+    void drain() {
+        std::vector<pollfd> fds;
+        std::vector<Connection*> polled;
+        for (auto& entry : m_connections) {
+            if (!entry.second->busy) {
+                fds.push_back({ entry.first, pollEvents(*entry.second), 0 });
+                polled.push_back(entry.second.get());
+            }
+        }
+        if (!fds.empty() && pollSockets(fds.data(), fds.size(), 0) > 0) {
+            for (size_t i = 0; i < polled.size(); ++i) {
+                if (fds[i].revents != 0) {
+                    dispatch(*polled[i]);
+                }
+            }
+        }
+        m_pool.drain();
+        collectReturned();
+
+        // Replies the clients haven't taken yet get a second to go out, sent
+        // from here now the workers are gone
+        auto deadline = Clock::now() + std::chrono::seconds(1);
+        StatsSlot& slot = threadStats();
+        while (Clock::now() < deadline) {
+            fds.clear();
+            polled.clear();
+            for (auto& entry : m_connections) {
+                if (!entry.second->output.empty()) {
+                    fds.push_back({ entry.first, POLLOUT, 0 });
+                    polled.push_back(entry.second.get());
+                }
+            }
+            if (fds.empty() || pollSockets(fds.data(), fds.size(), 100) < 0) {
+                break;
+            }
+            for (size_t i = 0; i < polled.size(); ++i) {
+                if (fds[i].revents != 0) {
+                    flushOutput(*polled[i], m_config.recordSize, slot);
+                    if (polled[i]->closeReason != nullptr) {
+                        closeConnection(*polled[i], polled[i]->closeReason);
+                    }
+                }
+            }
+        }
+
+        std::vector<Connection*> remaining;
+        for (auto& entry : m_connections) {
+            remaining.push_back(entry.second.get());
+        }
+        for (Connection* connection : remaining) {
+            closeConnection(*connection, "closed at shutdown");
+        }
+    }
+
+    SOCKET m_listenSocket;
+    SOCKET m_wakeSocket = INVALID_SOCKET;
+    const PoolConfig& m_config;
+    std::atomic<int>& m_clientCount;
+    int m_nextClientId = 1;
+    std::atomic<bool> m_wakePending{ false };
+    std::mutex m_returnedMutex;
+    std::vector<Connection*> m_returned;
+    std::unordered_map<SOCKET, std::unique_ptr<Connection>> m_connections;
+    WorkStealingPool m_pool;  // Last: its tasks use everything above
+};
+
+} // namespace
+
+int runPoolServer(SOCKET listenSocket, const PoolConfig& config,
+                  std::atomic<int>& clientCount, const std::atomic<bool>& running) {
+    if (!setNonBlocking(listenSocket)) {
+        std::cerr << "Server: Failed to make listening socket non-blocking: " << socketErrorString() << std::endl;
+        return 1;
+    }
+    std::unique_ptr<PoolServer> server;
+    try {
+        server = std::make_unique<PoolServer>(listenSocket, config, clientCount);
+    } catch (const std::exception& ex) {
+        std::cerr << "Server: Failed to start thread pool: " << ex.what() << std::endl;
+        return 1;
+    }
+    std::cout << "Server: thread pool mode with " << config.workers << " workers (max "
+              << config.maxConnections << " connections)" << std::endl;
+
+    ServerStats::instance().watchListener(listenSocket);
+    server->run(running);
+    ServerStats::instance().unwatchListener(listenSocket);
+    return 0;
+}
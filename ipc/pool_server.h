@@ -0,0 +1,23 @@
+#pragma once
+
+// Thread pool mode for the Server, and the only one on Windows: a
+// dispatcher thread polls the listener and every idle connection, and hands
+// each connection with input waiting (or replies left to send) to a fixed
+// pool of worker threads, which read it, answer every complete frame and
+// hand it back.
+
+#include "net.h"
+#include <atomic>
+
+struct PoolConfig {
+    int workers = 4;                 // Worker threads
+    int maxConnections = 1024;       // Stop accepting above this
+    int idleTimeoutSeconds = 30;     // Close connections idle this long
+    size_t recordSize = 0;           // Seqpacket: largest send or recv, else 0
+};
+
+// Serve clients on listenSocket until running becomes false, then finish
+// the requests already received and close every connection. Returns the
+// process exit code.
+int runPoolServer(SOCKET listenSocket, const PoolConfig& config,
+                  std::atomic<int>& clientCount, const std::atomic<bool>& running);
@@ -0,0 +1,126 @@
+#pragma once
+
+// Wire format shared by the Server and Client. Every message is a frame:
+//
+//   uint32 payload length (big-endian) | uint8 type | 3 reserved bytes | payload
+//
+// so any number of frames can share a packet and a payload may be any size
+// up to MAX_FRAME_PAYLOAD.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class FrameType : uint8_t {
+    Message = 1,  // Client text for the server to echo
+    Reply = 2,    // Server's answer to a Message
+    Quit = 3,     // Client is disconnecting
+    Stats = 4     // Request for the server's counters, and the answer
+};
+
+constexpr size_t FRAME_HEADER_SIZE = 8;
+constexpr uint32_t MAX_FRAME_PAYLOAD = 16 * 1024 * 1024;
+
+struct Frame {
+    FrameType type;
+    std::string_view payload;  // Into the parser's buffer, valid until its next prepare()
+};
+
+// Write a frame header for a payload of length bytes
+inline void encodeFrameHeader(char* header, FrameType type, size_t length) {
+    header[0] = static_cast<char>(length >> 24);
+    header[1] = static_cast<char>(length >> 16);
+    header[2] = static_cast<char>(length >> 8);
+    header[3] = static_cast<char>(length);
+    header[4] = static_cast<char>(type);
+    header[5] = header[6] = header[7] = 0;
+}
+
+// Append the header of a frame whose payload (length bytes) the caller
+// appends next
+inline void appendFrameHeader(std::string& out, FrameType type, size_t length) {
+    char header[FRAME_HEADER_SIZE];
+    encodeFrameHeader(header, type, length);
+    out.append(header, FRAME_HEADER_SIZE);
+}
+
+inline void appendFrame(std::string& out, FrameType type, std::string_view payload) {
+    appendFrameHeader(out, type, payload.size());
+    out.append(payload.data(), payload.size());
+}
+
+// Incremental frame parser over a growable receive buffer. Data is read
+// straight into prepare()'s space and frames are handed out as views into
+// the buffer, so payloads are never copied. Consumed bytes are reclaimed
+// lazily by the next prepare().
+class FrameParser {
+public:
+    enum class Status {
+        Complete,   // frame holds the next frame
+        NeedMore,   // No complete frame buffered
+        Invalid     // Oversized frame; the stream can't be resynchronised
+    };
+
+    // Space for at least minSpace more bytes (more while a large frame is
+    // incomplete); write into it and then commit() the byte count
+    char* prepare(size_t minSpace) {
+        if (m_begin == m_end) {
+            m_begin = m_end = 0;
+        }
+        size_t wanted = std::max(minSpace, m_frameSize > buffered() ? m_frameSize - buffered() : 0);
+        if (m_buffer.size() - m_end < wanted) {
+            // Frames handed out so far become invalid here
+            std::memmove(m_buffer.data(), m_buffer.data() + m_begin, buffered());
+            m_end -= m_begin;
+            m_begin = 0;
+            if (m_buffer.size() - m_end < wanted) {
+                m_buffer.resize(std::max(m_buffer.size() * 2, m_end + wanted));
+            }
+        }
+        return m_buffer.data() + m_end;
+    }
+
+    // Bytes writable at prepare()'s pointer
+    size_t writable() const { return m_buffer.size() - m_end; }
+
+    void commit(size_t count) { m_end += count; }
+
+    // Copy in data received elsewhere
+    void append(const char* data, size_t count) {
+        std::memcpy(prepare(count), data, count);
+        commit(count);
+    }
+
+    Status next(Frame& frame) {
+        if (buffered() < FRAME_HEADER_SIZE) {
+            return Status::NeedMore;
+        }
+        auto* header = reinterpret_cast<const unsigned char*>(m_buffer.data() + m_begin);
+        uint32_t length = (uint32_t(header[0]) << 24) | (uint32_t(header[1]) << 16)
+            | (uint32_t(header[2]) << 8) | uint32_t(header[3]);
+        if (length > MAX_FRAME_PAYLOAD) {
+            return Status::Invalid;
+        }
+        m_frameSize = FRAME_HEADER_SIZE + length;
+        if (buffered() < m_frameSize) {
+            return Status::NeedMore;
+        }
+        frame.type = static_cast<FrameType>(header[4]);
+        frame.payload = std::string_view(m_buffer.data() + m_begin + FRAME_HEADER_SIZE, length);
+        m_begin += m_frameSize;
+        m_frameSize = 0;
+        return Status::Complete;
+    }
+
+    // Received bytes not yet returned as frames
+    size_t buffered() const { return m_end - m_begin; }
+
+private:
+    std::vector<char> m_buffer;
+    size_t m_begin = 0;      // First unparsed byte
+    size_t m_end = 0;        // End of received data
+    size_t m_frameSize = 0;  // Size of the incomplete frame at m_begin, once its header is in
+};
@@ -1,277 +1,160 @@
+#include "server_common.h"
+#include "pool_server.h"
+#include "transport.h"
+#ifdef __linux__
+#include "epoll_server.h"
+#include "uring_server.h"
+#endif
+
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <cstring>
 #include <thread>
-#include <vector>
-#include <mutex>
 #include <atomic>
-#include <sstream>
 #include <csignal>
 
-#ifdef _WIN32
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#pragma comment(lib, "ws2_32.lib")
-typedef int socklen_t;
-#else
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <unistd.h>
-#define SOCKET int
-#define INVALID_SOCKET -1
-#define SOCKET_ERROR -1
-#define closesocket close
-#endif
-
-constexpr int PORT = 8080;
-constexpr int BUFFER_SIZE = 1024;
-
-std::mutex coutMutex;
 std::atomic<int> clientCount{ 0 };
 std::atomic<bool> serverRunning{true};
 
-void initializeSockets() {
-#ifdef _WIN32
-    WSADATA wsaData;
-    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-        std::cerr << "WSAStartup failed" << std::endl;
-        exit(1);
-    }
-#endif
-}
+std::atomic<int> stopSignal{ 0 };
 
-void cleanupSockets() {
-#ifdef _WIN32
-    WSACleanup();
-#endif
+// Only async-signal-safe work here; logStop() reports it once serving ends
+void signalHandler(int signal) {
+    stopSignal = signal;
+    serverRunning = false;
 }
 
-template<typename... Args>
-void logThreadSafe(Args&&... args) {
-    std::lock_guard<std::mutex> lock(coutMutex);
-    std::ostringstream oss;
-    (oss << ... << args);
-    std::cout << oss.str() << std::endl;
+void logStop() {
+    if (stopSignal != 0) {
+        logInfo("Server: Stopped by signal ", stopSignal);
+    }
 }
 
-void handleClient(SOCKET clientSocket, int clientId) {
-    logThreadSafe("Server: Client #", clientId, " connected! (Total clients: ", clientCount, ")");
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [--mode=epoll|uring|threads] [--threads=N] [--max-connections=N]"
+              << " [--reuseport] [--pin] [--listen=tcp:[HOST:]PORT|unix:PATH|seqpacket:PATH]" << std::endl
+              << "A Unix PATH starting with @ is a Linux abstract socket name." << std::endl;
+}
 
-    // Set socket timeout to detect dead connections
-#ifdef _WIN32
-    DWORD timeout = 30000; // 30 seconds
-    setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
-    setsockopt(clientSocket, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+int main(int argc, char* argv[]) {
+    // Connection handling mode: an epoll reactor where available, otherwise
+    // (or with --mode=threads) a poll dispatcher feeding a thread pool
+#ifdef __linux__
+    bool useReactor = true;
+    bool useUring = false;
+    ReactorConfig reactorConfig;
 #else
-    struct timeval timeout;
-    timeout.tv_sec = 30;
-    timeout.tv_usec = 0;
-    setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
-    setsockopt(clientSocket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    bool useReactor = false;
 #endif
-
-    char buffer[BUFFER_SIZE];
-    bool connectionAlive = true;
-
-    while (connectionAlive) {
-        memset(buffer, 0, BUFFER_SIZE);
-        int bytesReceived = recv(clientSocket, buffer, BUFFER_SIZE - 1, 0);
-
-        if (bytesReceived == 0) {
-            // Client closed connection gracefully
-            logThreadSafe("Server: Client #", clientId, " closed connection gracefully");
-            break;
-        } 
-        else if (bytesReceived < 0) {
-            // Error occurred
-#ifdef _WIN32
-            int error = WSAGetLastError();
-            if (error == WSAETIMEDOUT) {
-                logThreadSafe("Server: Client #", clientId, " connection timed out");
-            } else if (error == WSAECONNRESET) {
-                logThreadSafe("Server: Client #", clientId, " connection reset by peer");
-            } else {
-                logThreadSafe("Server: Client #", clientId, " receive error: ", error);
-            }
-#else
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                logThreadSafe("Server: Client #", clientId, " connection timed out");
-            } else if (errno == ECONNRESET) {
-                logThreadSafe("Server: Client #", clientId, " connection reset by peer");
-            } else {
-                logThreadSafe("Server: Client #", clientId, " receive error: ", strerror(errno));
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    int maxConnections = 0;  // 0: the mode's default
+    Endpoint endpoint;
+    endpoint.host = "0.0.0.0";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--mode=threads") {
+            useReactor = false;
+        } else if (arg.rfind("--listen=", 0) == 0) {
+            std::string error;
+            if (!parseEndpoint(arg.substr(9), endpoint, error)) {
+                std::cerr << "Server: " << error << std::endl;
+                return 1;
             }
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            threads = std::max(1, std::atoi(arg.c_str() + 10));
+        } else if (arg.rfind("--max-connections=", 0) == 0) {
+            maxConnections = std::max(1, std::atoi(arg.c_str() + 18));
+#ifdef __linux__
+        } else if (arg == "--mode=epoll") {
+            useReactor = true;
+            useUring = false;
+        } else if (arg == "--mode=uring") {
+            useReactor = true;
+            useUring = true;
+        } else if (arg == "--reuseport") {
+            reactorConfig.reusePort = true;
+            reactorConfig.pinThreads = true;
+        } else if (arg == "--pin") {
+            reactorConfig.pinThreads = true;
 #endif
-            break;
-        }
-
-        std::string message(buffer, bytesReceived);
-        
-        // Validate message isn't empty or contains only whitespace
-        if (message.empty() || message.find_first_not_of(" \t\n\r") == std::string::npos) {
-            logThreadSafe("Server: Client #", clientId, " sent empty or invalid message");
-            continue;
+        } else {
+            printUsage(argv[0]);
+            return 1;
         }
-
-        logThreadSafe("Server: Client #", clientId, " sent: ", message);
-
-        if (message == "quit") {
-            logThreadSafe("Server: Client #", clientId, " requested disconnect");
-            break;
-        }
-
-        // Send response with error checking
-        std::string response = "Echo from server to client #" + std::to_string(clientId) + ": " + message;
-        int bytesSent = send(clientSocket, response.c_str(), static_cast<int>(response.length()), 0);
-        
-        if (bytesSent == SOCKET_ERROR) {
-#ifdef _WIN32
-            int error = WSAGetLastError();
-            logThreadSafe("Server: Client #", clientId, " send error: ", error);
-#else
-            logThreadSafe("Server: Client #", clientId, " send error: ", strerror(errno));
-#endif
-            connectionAlive = false;
-        } else if (bytesSent < static_cast<int>(response.length())) {
-            logThreadSafe("Server: Client #", clientId, " partial send (", bytesSent, "/", response.length(), " bytes)");
-        }
-    }
-
-    closesocket(clientSocket);
-    --clientCount;
-
-    logThreadSafe("Server: Client #", clientId, " handler terminated (Remaining clients: ", clientCount, ")");
-}
-
-void handleClientSafe(SOCKET clientSocket, int clientId) {
-    try {
-        handleClient(clientSocket, clientId);
-    } catch (const std::exception& ex) {
-        logThreadSafe("Server: Client #", clientId, " exception: ", ex.what());
-        closesocket(clientSocket);
-        --clientCount;
-    } catch (...) {
-        logThreadSafe("Server: Client #", clientId, " unknown exception occurred");
-        closesocket(clientSocket);
-        --clientCount;
     }
-}
-
-void signalHandler(int signal) {
-    logThreadSafe("Server: Received signal ", signal, ", shutting down...");
-    serverRunning = false;
-}
 
-int main() {
     std::cout << "Server: Starting multi-client server..." << std::endl;
     initializeSockets();
 
-    SOCKET serverSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (serverSocket == INVALID_SOCKET) {
-#ifdef _WIN32
-        std::cerr << "Server: Failed to create socket. Error: " << WSAGetLastError() << std::endl;
-#else
-        std::cerr << "Server: Failed to create socket. Error: " << strerror(errno) << std::endl;
-#endif
-        cleanupSockets();
-        return 1;
-    }
-
-    // Allow socket reuse
-    int opt = 1;
-#ifdef _WIN32
-    if (setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt)) == SOCKET_ERROR) {
-        std::cerr << "Server: Failed to set SO_REUSEADDR. Error: " << WSAGetLastError() << std::endl;
-    }
-#else
-    if (setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == SOCKET_ERROR) {
-        std::cerr << "Server: Failed to set SO_REUSEADDR. Error: " << strerror(errno) << std::endl;
+#ifdef __linux__
+    reactorConfig.threads = threads;
+    if (maxConnections != 0) {
+        reactorConfig.maxConnections = maxConnections;
     }
-#endif
-
-    sockaddr_in serverAddr{};
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_addr.s_addr = INADDR_ANY;
-    serverAddr.sin_port = htons(PORT);
-
-    if (bind(serverSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
-#ifdef _WIN32
-        std::cerr << "Server: Bind failed. Error: " << WSAGetLastError() << std::endl;
-#else
-        std::cerr << "Server: Bind failed. Error: " << strerror(errno) << std::endl;
-#endif
-        closesocket(serverSocket);
+    reactorConfig.endpoint = endpoint;
+    if (useReactor && reactorConfig.reusePort && endpoint.transport != Transport::Tcp) {
+        std::cerr << "Server: --reuseport needs a tcp: endpoint" << std::endl;
         cleanupSockets();
         return 1;
     }
-
-    if (listen(serverSocket, SOMAXCONN) == SOCKET_ERROR) {
-#ifdef _WIN32
-        std::cerr << "Server: Listen failed. Error: " << WSAGetLastError() << std::endl;
+    // Every reactor's listener, this one included, sets SO_REUSEPORT before bind
+    bool reusePort = useReactor && reactorConfig.reusePort;
 #else
-        std::cerr << "Server: Listen failed. Error: " << strerror(errno) << std::endl;
+    bool reusePort = false;
 #endif
-        closesocket(serverSocket);
+
+    std::string error;
+    SOCKET serverSocket = listenOn(endpoint, reusePort, error);
+    if (serverSocket == INVALID_SOCKET) {
+        std::cerr << "Server: " << error << std::endl;
         cleanupSockets();
         return 1;
     }
 
-    std::cout << "Server: Listening on port " << PORT << " for multiple clients..." << std::endl;
+    std::cout << "Server: Listening on " << endpoint.describe() << " for multiple clients..." << std::endl;
     std::cout << "Server: Press Ctrl+C to stop" << std::endl;
 
-    std::vector<std::thread> clientThreads;
-    int nextClientId = 1;
-    constexpr int MAX_CLIENTS = 100; // Limit concurrent connections
-
     std::signal(SIGINT, signalHandler);
     std::signal(SIGTERM, signalHandler);
 
-    while (serverRunning) {
-        // Check if we've reached max clients
-        if (clientCount >= MAX_CLIENTS) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            continue;
+#ifdef __linux__
+    if (useReactor && useUring) {
+        // Seqpacket records can be larger than the ring's receive buffers
+        std::string reason = "seqpacket endpoint";
+        if (endpoint.transport != Transport::SeqPacket && uringAvailable(reason)) {
+            int result = runUringServer(serverSocket, reactorConfig, clientCount, serverRunning);
+            logStop();
+            closesocket(serverSocket);
+            removeEndpoint(endpoint);
+            cleanupSockets();
+            return result;
         }
-
-        sockaddr_in clientAddr{};
-        socklen_t clientAddrLen = sizeof(clientAddr);
-        SOCKET clientSocket = accept(serverSocket, (sockaddr*)&clientAddr, &clientAddrLen);
-
-        if (clientSocket == INVALID_SOCKET) {
-#ifdef _WIN32
-            int error = WSAGetLastError();
-            std::cerr << "Server: Accept failed. Error: " << error << std::endl;
-            if (error == WSAEINTR) {
-                // Interrupted, likely shutting down
-                break;
-            }
-#else
-            std::cerr << "Server: Accept failed. Error: " << strerror(errno) << std::endl;
-            if (errno == EINTR) {
-                // Interrupted, likely shutting down
-                break;
-            }
+        std::cout << "Server: io_uring unavailable (" << reason << "), falling back to epoll" << std::endl;
+    }
+    if (useReactor) {
+        int result = runEpollServer(serverSocket, reactorConfig, clientCount, serverRunning);
+        logStop();
+        closesocket(serverSocket);
+        removeEndpoint(endpoint);
+        cleanupSockets();
+        return result;
+    }
 #endif
-            continue;
-        }
 
-        ++clientCount;
-        int clientId = nextClientId++;
-
-        try {
-            // Create a new thread to handle this client with exception wrapper
-            clientThreads.emplace_back(handleClientSafe, clientSocket, clientId);
-            clientThreads.back().detach();
-        } catch (const std::system_error& e) {
-            logThreadSafe("Server: Failed to create thread for client #", clientId, ": ", e.what());
-            closesocket(clientSocket);
-            --clientCount;
-        }
+    PoolConfig poolConfig;
+    poolConfig.workers = threads;
+    if (maxConnections != 0) {
+        poolConfig.maxConnections = maxConnections;
     }
+    poolConfig.recordSize = endpoint.recordSize();
+    int result = runPoolServer(serverSocket, poolConfig, clientCount, serverRunning);
 
     // Cleanup
+    logStop();
     closesocket(serverSocket);
+    removeEndpoint(endpoint);
     cleanupSockets();
 
-    return 0;
+    return result;
 }
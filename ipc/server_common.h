@@ -0,0 +1,62 @@
+#pragma once
+
+// Pieces shared by the Server's connection handling modes
+
+#include "net.h"
+#include "protocol.h"
+#include "output_buffer.h"
+#include "logger.h"
+#include "server_stats.h"
+#include <cstdio>
+#include <string>
+
+enum class MessageResult {
+    Reply,   // A reply frame was appended to output
+    Ignore,  // Nothing to send
+    Quit     // Client asked to disconnect
+};
+
+// Handle one frame from a client, appending any reply frame to output. A
+// long message is echoed by reference, so the frame must stay valid until
+// output is flushed or detached.
+inline MessageResult handleMessage(int clientId, const Frame& frame, OutputBuffer& output,
+                                   ConnectionStats& stats) {
+    StatsSlot& slot = threadStats();
+    slot.messageIn(stats);
+    if (frame.type == FrameType::Stats) {
+        std::string report = ServerStats::instance().report(clientId, stats);
+        char header[FRAME_HEADER_SIZE];
+        encodeFrameHeader(header, FrameType::Stats, report.size());
+        output.append(std::string_view(header, FRAME_HEADER_SIZE));
+        output.append(report);
+        slot.messageOut(stats);
+        return MessageResult::Reply;
+    }
+    if (frame.type == FrameType::Quit) {
+        logInfo("Server: Client #", clientId, " requested disconnect");
+        return MessageResult::Quit;
+    }
+    if (frame.type != FrameType::Message) {
+        logWarning("Server: Client #", clientId, " sent unexpected frame type ", static_cast<int>(frame.type));
+        return MessageResult::Ignore;
+    }
+
+    // Validate message isn't empty or contains only whitespace
+    std::string_view message = frame.payload;
+    if (message.empty() || message.find_first_not_of(" \t\n\r") == std::string_view::npos) {
+        logWarning("Server: Client #", clientId, " sent empty or invalid message");
+        return MessageResult::Ignore;
+    }
+
+    logDebug("Server: Client #", clientId, " sent: ", message);
+
+    // Header and "Echo from server to client #N: " are built in place
+    char head[FRAME_HEADER_SIZE + 64];
+    int prefixLength = std::snprintf(head + FRAME_HEADER_SIZE, sizeof(head) - FRAME_HEADER_SIZE,
+        "Echo from server to client #%d: ", clientId);
+    encodeFrameHeader(head, FrameType::Reply, prefixLength + message.size());
+    output.append(std::string_view(head, FRAME_HEADER_SIZE + prefixLength));
+    output.appendReference(message);
+    slot.messageOut(stats);
+    return MessageResult::Reply;
+}
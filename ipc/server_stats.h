@@ -0,0 +1,285 @@
+#pragma once
+
+// Connection and traffic counters for the Server. Like the logger, every
+// serving thread gets a slot of its own on first use, padded to a cache
+// line and written only by that thread, so counting, latency histogram
+// included, costs plain stores with no lock or read-modify-write.
+// A Stats frame from any client returns the sum over all slots, a latency
+// histogram and the listeners' accept queue depth as "name value" lines.
+//
+// Latency is the time from reading a request to having written every reply
+// queued up to then, i.e. how long requests wait inside the server.
+
+#include "net.h"
+#include "histogram.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+enum class Counter : size_t {
+    Accepted,
+    Closed,
+    BytesIn,
+    BytesOut,
+    MessagesIn,
+    MessagesOut,
+    RecvCalls,     // Receive completions in io_uring mode
+    SendCalls,     // Send submissions in io_uring mode
+    Backpressure,  // Reads paused because a client wasn't taking its replies
+    Count
+};
+
+constexpr const char* COUNTER_NAMES[] = {
+    "accepted", "closed", "bytes_in", "bytes_out", "messages_in", "messages_out",
+    "recv_calls", "send_calls", "backpressure_pauses"
+};
+static_assert(std::size(COUNTER_NAMES) == static_cast<size_t>(Counter::Count));
+
+// Counters of one connection, kept by the thread serving it
+struct ConnectionStats {
+    std::chrono::steady_clock::time_point connectedAt = std::chrono::steady_clock::now();
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    uint64_t messagesIn = 0;
+    uint64_t messagesOut = 0;
+    uint64_t recvCalls = 0;
+    uint64_t sendCalls = 0;
+};
+
+// One thread's share of the server-wide counters
+class alignas(64) StatsSlot {
+public:
+    explicit StatsSlot(int id) : m_id(id) {}
+
+    void received(ConnectionStats& connection, size_t bytes) {
+        ++connection.recvCalls;
+        connection.bytesIn += bytes;
+        add(Counter::RecvCalls, 1);
+        add(Counter::BytesIn, bytes);
+    }
+
+    void sent(ConnectionStats& connection, size_t bytes) {
+        ++connection.sendCalls;
+        connection.bytesOut += bytes;
+        add(Counter::SendCalls, 1);
+        add(Counter::BytesOut, bytes);
+    }
+
+    void messageIn(ConnectionStats& connection) {
+        ++connection.messagesIn;
+        add(Counter::MessagesIn, 1);
+    }
+
+    void messageOut(ConnectionStats& connection) {
+        ++connection.messagesOut;
+        add(Counter::MessagesOut, 1);
+    }
+
+    void accepted() { add(Counter::Accepted, 1); }
+    void closed() { add(Counter::Closed, 1); }
+    void backpressure() { add(Counter::Backpressure, 1); }
+
+    void latency(std::chrono::steady_clock::duration elapsed) {
+        m_latencyNs.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+    int id() const { return m_id; }
+    uint64_t get(Counter counter) const {
+        return m_counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+    }
+
+    void mergeLatencyInto(LatencyHistogram& histogram) const {
+        m_latencyNs.mergeInto(histogram);
+    }
+
+private:
+    // Only the owning thread writes, so no read-modify-write is needed
+    void add(Counter counter, uint64_t amount) {
+        auto& value = m_counters[static_cast<size_t>(counter)];
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    int m_id;
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(Counter::Count)> m_counters{};
+    SharedLatencyHistogram m_latencyNs;
+};
+
+class ServerStats {
+public:
+    static ServerStats& instance() {
+        static ServerStats stats;
+        return stats;
+    }
+
+    ServerStats(const ServerStats&) = delete;
+    ServerStats& operator=(const ServerStats&) = delete;
+
+    // The calling thread's slot
+    StatsSlot& local() {
+        thread_local ThreadSlot local;
+        if (!local.slot) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            local.slot = std::make_shared<StatsSlot>(m_nextId++);
+            m_slots.push_back(local.slot);
+        }
+        return *local.slot;
+    }
+
+    // Listening sockets whose accept queue is reported
+    void watchListener(SOCKET listener) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_listeners.push_back(listener);
+    }
+
+    void unwatchListener(SOCKET listener) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_listeners.erase(std::remove(m_listeners.begin(), m_listeners.end(), listener), m_listeners.end());
+    }
+
+    // The connection limit left new connections in the listen backlog
+    void acceptPaused() { m_acceptPauses.fetch_add(1, std::memory_order_relaxed); }
+
+    // Server-wide counters, then those of the requesting connection
+    std::string report(int clientId, const ConnectionStats& connection) {
+        std::array<uint64_t, static_cast<size_t>(Counter::Count)> totals{};
+        LatencyHistogram latencyNs;
+        std::string perThread;
+        int queued = 0;
+        int backlog = 0;
+        bool haveQueue;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            haveQueue = acceptQueue(queued, backlog);
+            totals = m_retired;
+            latencyNs = m_retiredLatencyNs;
+            for (auto& slot : m_slots) {
+                for (size_t i = 0; i < totals.size(); ++i) {
+                    totals[i] += slot->get(static_cast<Counter>(i));
+                }
+                slot->mergeLatencyInto(latencyNs);
+                uint64_t messages = slot->get(Counter::MessagesIn);
+                if (messages != 0) {
+                    perThread += "thread." + std::to_string(slot->id()) + ".messages_in "
+                        + std::to_string(messages) + "\n";
+                }
+            }
+        }
+
+        std::string out;
+        auto line = [&out](const char* name, uint64_t value) {
+            out += name;
+            out += ' ';
+            out += std::to_string(value);
+            out += '\n';
+        };
+        auto microseconds = [&out](const char* name, uint64_t ns) {
+            char buffer[64];
+            std::snprintf(buffer, sizeof(buffer), "%s %.1f\n", name, ns / 1000.0);
+            out += buffer;
+        };
+
+        line("clients", totals[size_t(Counter::Accepted)] - totals[size_t(Counter::Closed)]);
+        for (size_t i = 0; i < totals.size(); ++i) {
+            line(COUNTER_NAMES[i], totals[i]);
+        }
+        line("accept_pauses", m_acceptPauses.load(std::memory_order_relaxed));
+        if (haveQueue) {
+            line("accept_queue", static_cast<uint64_t>(queued));
+            line("accept_backlog", static_cast<uint64_t>(backlog));
+        }
+        microseconds("latency_p50_us", latencyNs.percentile(0.50));
+        microseconds("latency_p99_us", latencyNs.percentile(0.99));
+        microseconds("latency_p999_us", latencyNs.percentile(0.999));
+        microseconds("latency_max_us", latencyNs.max());
+        out += perThread;
+
+        line("connection.id", static_cast<uint64_t>(clientId));
+        line("connection.age_seconds", static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::steady_clock::now() - connection.connectedAt).count()));
+        line("connection.bytes_in", connection.bytesIn);
+        line("connection.bytes_out", connection.bytesOut);
+        line("connection.messages_in", connection.messagesIn);
+        line("connection.messages_out", connection.messagesOut);
+        line("connection.recv_calls", connection.recvCalls);
+        line("connection.send_calls", connection.sendCalls);
+        return out;
+    }
+
+private:
+    // Owning handle of the calling thread's slot. Its counts are folded
+    // into the retired totals when the thread exits.
+    struct ThreadSlot {
+        std::shared_ptr<StatsSlot> slot;
+        ~ThreadSlot() {
+            if (slot) {
+                ServerStats::instance().retire(slot);
+            }
+        }
+    };
+
+    ServerStats() = default;
+
+    void retire(const std::shared_ptr<StatsSlot>& slot) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < m_retired.size(); ++i) {
+            m_retired[i] += slot->get(static_cast<Counter>(i));
+        }
+        slot->mergeLatencyInto(m_retiredLatencyNs);
+        m_slots.erase(std::remove(m_slots.begin(), m_slots.end(), slot), m_slots.end());
+    }
+
+    // Connections waiting in the listeners' accept queues and the queues'
+    // limit. Linux reports both through TCP_INFO on a TCP listener; Unix
+    // listeners have no equivalent. Called with m_mutex held.
+    bool acceptQueue(int& queued, int& backlog) const {
+#ifdef __linux__
+        bool any = false;
+        for (SOCKET listener : m_listeners) {
+            tcp_info info{};
+            socklen_t length = sizeof(info);
+            if (getsockopt(listener, IPPROTO_TCP, TCP_INFO, &info, &length) == 0) {
+                queued += static_cast<int>(info.tcpi_unacked);
+                backlog += static_cast<int>(info.tcpi_sacked);
+                any = true;
+            }
+        }
+        return any;
+#else
+        (void)queued;
+        (void)backlog;
+        return false;
+#endif
+    }
+
+    std::mutex m_mutex;
+    std::vector<std::shared_ptr<StatsSlot>> m_slots;
+    std::array<uint64_t, static_cast<size_t>(Counter::Count)> m_retired{};
+    LatencyHistogram m_retiredLatencyNs;
+    std::vector<SOCKET> m_listeners;
+    std::atomic<uint64_t> m_acceptPauses{ 0 };
+    int m_nextId = 0;
+};
+
+inline StatsSlot& threadStats() { return ServerStats::instance().local(); }
+
+// Per-connection totals, logged when it closes
+inline void logConnectionStats(int clientId, const ConnectionStats& stats) {
+    logDebug("Server: Client #", clientId, " totals: ", stats.messagesIn, " messages in, ",
+        stats.messagesOut, " out, ", stats.bytesIn, " bytes in, ", stats.bytesOut, " out, ",
+        stats.recvCalls, " recvs, ", stats.sendCalls, " sends");
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+// Fixed-size work-stealing thread pool. Each worker has its own task queue;
+// submit() spreads tasks round-robin and a worker whose queue is empty
+// steals from the others, so one slow task doesn't hold up the tasks queued
+// behind it. Submitting and taking only lock the one queue involved; the
+// sleep mutex is only touched when a worker runs out of work or one has to
+// be woken. drain() runs everything already submitted and joins the
+// workers; nothing is ever detached.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(int threads) {
+        size_t count = threads > 0 ? static_cast<size_t>(threads) : 1;
+        for (size_t i = 0; i < count; ++i) {
+            m_queues.push_back(std::make_unique<Queue>());
+        }
+        for (size_t i = 0; i < count; ++i) {
+            m_threads.emplace_back([this, i] { run(i); });
+        }
+    }
+
+    ~WorkStealingPool() { drain(); }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t size() const { return m_queues.size(); }
+
+    void submit(Task task) {
+        size_t index = m_next.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+        {
+            std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+            m_queues[index]->tasks.push_back(std::move(task));
+            m_pending.fetch_add(1, std::memory_order_seq_cst);
+        }
+        // Pairs with the worker raising m_idle before it checks m_pending:
+        // either it sees this task or this sees it going to sleep
+        if (m_idle.load(std::memory_order_seq_cst) != 0) {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_wake.notify_one();
+        }
+    }
+
+    // Finish every submitted task, then stop and join the workers. Tasks
+    // may still submit more while this waits; those run too.
+    void drain() {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+        for (auto& thread : m_threads) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+    }
+
+private:
+    // Padded so workers taking from neighbouring queues don't share a line
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // Oldest first from the worker's own queue, so connections are served
+    // in arrival order; thieves take the newest from the back
+    bool take(size_t self, Task& task) {
+        for (size_t i = 0; i < m_queues.size(); ++i) {
+            Queue& queue = *m_queues[(self + i) % m_queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            if (i == 0) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            } else {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+            // Under the queue lock, so m_pending never counts a task that's gone
+            m_pending.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    void run(size_t self) {
+        for (;;) {
+            Task task;
+            if (take(self, task)) {
+                task();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_idle.fetch_add(1, std::memory_order_seq_cst);
+            m_wake.wait(lock, [this] {
+                return m_pending.load(std::memory_order_seq_cst) != 0 || m_stopping;
+            });
+            m_idle.fetch_sub(1, std::memory_order_relaxed);
+            if (m_pending.load(std::memory_order_relaxed) == 0) {
+                return;  // Stopping with nothing left
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::atomic<size_t> m_next{ 0 };
+    std::atomic<size_t> m_pending{ 0 };  // Submitted and not yet taken
+    std::atomic<int> m_idle{ 0 };        // Workers asleep or about to be
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    bool m_stopping = false;             // Guarded by m_sleepMutex
+    std::vector<std::thread> m_threads;
+};
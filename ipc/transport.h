@@ -0,0 +1,239 @@
+#pragma once
+
+// Endpoints the Server listens on and clients connect to: TCP, or on POSIX
+// systems AF_UNIX stream and seqpacket sockets, which skip the TCP/IP stack
+// for same-host traffic. A Unix path starting with '@' names a Linux
+// abstract socket: it lives in no filesystem and vanishes with its last
+// descriptor.
+//
+// Spelled "tcp:[HOST:]PORT", "unix:PATH" or "seqpacket:PATH".
+
+#include "net.h"
+
+#include <algorithm>
+#include <string>
+
+#ifndef _WIN32
+#include <sys/un.h>
+#include <cstddef>
+#endif
+
+enum class Transport {
+    Tcp,
+    Unix,       // AF_UNIX SOCK_STREAM
+    SeqPacket   // AF_UNIX SOCK_SEQPACKET
+};
+
+// Largest record sent or received on a seqpacket socket. Records carry the
+// same framed byte stream as the other transports, cut at arbitrary points,
+// so all that matters is that each fits the receiver's buffer whole.
+constexpr size_t SEQPACKET_RECORD_SIZE = 64 * 1024;
+
+struct Endpoint {
+    Transport transport = Transport::Tcp;
+    std::string host = "127.0.0.1";  // TCP
+    int port = PORT;                  // TCP
+    std::string path;                 // Unix transports
+
+    // Largest single send or recv, or 0 for byte streams
+    size_t recordSize() const { return transport == Transport::SeqPacket ? SEQPACKET_RECORD_SIZE : 0; }
+
+    std::string describe() const {
+        if (transport == Transport::Tcp) {
+            return "tcp:" + host + ":" + std::to_string(port);
+        }
+        return (transport == Transport::Unix ? "unix:" : "seqpacket:") + path;
+    }
+};
+
+inline bool parseEndpoint(const std::string& spec, Endpoint& endpoint, std::string& error) {
+    size_t colon = spec.find(':');
+    std::string scheme = spec.substr(0, colon);
+    std::string rest = colon == std::string::npos ? "" : spec.substr(colon + 1);
+    if (scheme == "tcp") {
+        endpoint.transport = Transport::Tcp;
+        size_t portColon = rest.rfind(':');
+        if (portColon != std::string::npos) {
+            endpoint.host = rest.substr(0, portColon);
+            rest = rest.substr(portColon + 1);
+        }
+        endpoint.port = std::atoi(rest.c_str());
+        if (endpoint.port <= 0 || endpoint.port > 65535) {
+            error = "bad TCP port in '" + spec + "'";
+            return false;
+        }
+        return true;
+    }
+    if (scheme == "unix" || scheme == "seqpacket") {
+#ifdef _WIN32
+        error = "Unix domain sockets are not supported on this platform";
+        return false;
+#else
+        endpoint.transport = scheme == "unix" ? Transport::Unix : Transport::SeqPacket;
+        endpoint.path = rest;
+        if (rest.empty() || rest.size() >= sizeof(sockaddr_un::sun_path)) {
+            error = "bad socket path in '" + spec + "'";
+            return false;
+        }
+        return true;
+#endif
+    }
+    error = "unknown transport in '" + spec + "' (use tcp:, unix: or seqpacket:)";
+    return false;
+}
+
+namespace transport_detail {
+
+#ifndef _WIN32
+// Fills address for a Unix endpoint and returns its length
+inline socklen_t unixAddress(const Endpoint& endpoint, sockaddr_un& address) {
+    address = sockaddr_un{};
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, endpoint.path.data(), endpoint.path.size());
+    if (endpoint.path[0] == '@') {
+        // Abstract: a leading NUL, and the length rather than a terminator
+        // ends the name
+        address.sun_path[0] = '\0';
+        return static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + endpoint.path.size());
+    }
+    return static_cast<socklen_t>(sizeof(address));
+}
+#endif
+
+inline SOCKET fail(SOCKET socket, std::string& error, const char* step) {
+    error = std::string(step) + " failed: " + socketErrorString();
+    if (socket != INVALID_SOCKET) {
+        closesocket(socket);
+    }
+    return INVALID_SOCKET;
+}
+
+} // namespace transport_detail
+
+// Listening socket for endpoint, with SO_REUSEADDR on TCP (and SO_REUSEPORT
+// when asked). A leftover socket file from an earlier run is replaced.
+// Returns INVALID_SOCKET with error set on failure.
+inline SOCKET listenOn(const Endpoint& endpoint, bool reusePort, std::string& error) {
+    using transport_detail::fail;
+    if (endpoint.transport == Transport::Tcp) {
+        SOCKET listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (listener == INVALID_SOCKET) {
+            return fail(listener, error, "socket");
+        }
+        int opt = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
+#ifdef SO_REUSEPORT
+        if (reusePort && setsockopt(listener, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == SOCKET_ERROR) {
+            return fail(listener, error, "SO_REUSEPORT");
+        }
+#endif
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(endpoint.port));
+        if (inet_pton(AF_INET, endpoint.host.c_str(), &address.sin_addr) != 1) {
+            error = "bad IPv4 address '" + endpoint.host + "'";
+            closesocket(listener);
+            return INVALID_SOCKET;
+        }
+        if (bind(listener, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR) {
+            return fail(listener, error, "Bind");
+        }
+        if (listen(listener, SOMAXCONN) == SOCKET_ERROR) {
+            return fail(listener, error, "Listen");
+        }
+        return listener;
+    }
+
+#ifdef _WIN32
+    (void)reusePort;
+    error = "Unix domain sockets are not supported on this platform";
+    return INVALID_SOCKET;
+#else
+    SOCKET listener = socket(AF_UNIX, endpoint.transport == Transport::Unix ? SOCK_STREAM : SOCK_SEQPACKET, 0);
+    if (listener == INVALID_SOCKET) {
+        return fail(listener, error, "socket");
+    }
+    sockaddr_un address;
+    socklen_t length = transport_detail::unixAddress(endpoint, address);
+    if (endpoint.path[0] != '@') {
+        unlink(endpoint.path.c_str());
+    }
+    if (bind(listener, (sockaddr*)&address, length) == SOCKET_ERROR) {
+        return fail(listener, error, "Bind");
+    }
+    if (listen(listener, SOMAXCONN) == SOCKET_ERROR) {
+        return fail(listener, error, "Listen");
+    }
+    return listener;
+#endif
+}
+
+// Connected socket to endpoint, or INVALID_SOCKET with error set
+inline SOCKET connectTo(const Endpoint& endpoint, std::string& error) {
+    using transport_detail::fail;
+    if (endpoint.transport == Transport::Tcp) {
+        SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (client == INVALID_SOCKET) {
+            return fail(client, error, "socket");
+        }
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(endpoint.port));
+        if (inet_pton(AF_INET, endpoint.host.c_str(), &address.sin_addr) != 1) {
+            error = "bad IPv4 address '" + endpoint.host + "'";
+            closesocket(client);
+            return INVALID_SOCKET;
+        }
+        if (connect(client, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR) {
+            return fail(client, error, "Connect");
+        }
+        return client;
+    }
+
+#ifdef _WIN32
+    error = "Unix domain sockets are not supported on this platform";
+    return INVALID_SOCKET;
+#else
+    SOCKET client = socket(AF_UNIX, endpoint.transport == Transport::Unix ? SOCK_STREAM : SOCK_SEQPACKET, 0);
+    if (client == INVALID_SOCKET) {
+        return fail(client, error, "socket");
+    }
+    sockaddr_un address;
+    socklen_t length = transport_detail::unixAddress(endpoint, address);
+    if (connect(client, (sockaddr*)&address, length) == SOCKET_ERROR) {
+        return fail(client, error, "Connect");
+    }
+    return client;
+#endif
+}
+
+// Remove a listener's socket file once the server is done with it
+inline void removeEndpoint(const Endpoint& endpoint) {
+#ifndef _WIN32
+    if (endpoint.transport != Transport::Tcp && endpoint.path[0] != '@') {
+        unlink(endpoint.path.c_str());
+    }
+#else
+    (void)endpoint;
+#endif
+}
+
+// Blocking send of all of data, in pieces of at most recordSize bytes when
+// that isn't 0
+inline bool sendAll(SOCKET socket, const char* data, size_t length, size_t recordSize) {
+#ifdef _WIN32
+    constexpr int flags = 0;
+#else
+    constexpr int flags = MSG_NOSIGNAL;
+#endif
+    while (length > 0) {
+        size_t chunk = recordSize != 0 ? std::min(length, recordSize) : length;
+        int sent = static_cast<int>(send(socket, data, static_cast<int>(chunk), flags));
+        if (sent == SOCKET_ERROR) {
+            return false;
+        }
+        data += sent;
+        length -= static_cast<size_t>(sent);
+    }
+    return true;
+}
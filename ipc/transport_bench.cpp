@@ -0,0 +1,140 @@
+// transport_bench.cpp : Round-trip latency of the Server over each transport.
+// The epoll server runs in-process on TCP loopback, a Unix stream socket
+// (filesystem and abstract name) and an abstract seqpacket socket; one
+// client at a time sends a message, waits for the echo and repeats.
+//
+// Usage: TransportBench [seconds per transport] [message bytes]
+//
+
+#include "epoll_server.h"
+#include "histogram.h"
+#include "logger.h"
+#include "protocol.h"
+#include "transport.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <netinet/tcp.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+// Ping-pong over one connection until the deadline, recording each round trip
+bool pingPong(const Endpoint& endpoint, const std::string& request, double seconds,
+              LatencyHistogram& latencyNs) {
+    std::string error;
+    SOCKET client = connectTo(endpoint, error);
+    if (client == INVALID_SOCKET) {
+        std::fprintf(stderr, "%s: %s\n", endpoint.describe().c_str(), error.c_str());
+        return false;
+    }
+    if (endpoint.transport == Transport::Tcp) {
+        int noDelay = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    }
+
+    size_t recordSize = endpoint.recordSize();
+    FrameParser input;
+    auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(seconds));
+    bool ok = true;
+    while (ok && Clock::now() < deadline) {
+        auto start = Clock::now();
+        ok = sendAll(client, request.data(), request.size(), recordSize);
+        Frame reply;
+        while (ok && input.next(reply) != FrameParser::Status::Complete) {
+            char* space = input.prepare(std::max<size_t>(BUFFER_SIZE, recordSize));
+            ssize_t received = recv(client, space, input.writable(), 0);
+            ok = received > 0;
+            if (ok) {
+                input.commit(static_cast<size_t>(received));
+            }
+        }
+        if (ok) {
+            latencyNs.record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()));
+        }
+    }
+    closesocket(client);
+    return ok;
+}
+
+void runTransport(const char* name, Endpoint endpoint, const std::string& request, double seconds) {
+    std::string error;
+    SOCKET listener = listenOn(endpoint, false, error);
+    if (listener == INVALID_SOCKET) {
+        std::printf("%-22s unavailable: %s\n", name, error.c_str());
+        return;
+    }
+    if (endpoint.transport == Transport::Tcp) {
+        // Bound to an ephemeral port; connect to whichever it got
+        sockaddr_in address{};
+        socklen_t length = sizeof(address);
+        getsockname(listener, (sockaddr*)&address, &length);
+        endpoint.port = ntohs(address.sin_port);
+    }
+
+    std::atomic<int> clientCount{ 0 };
+    std::atomic<bool> running{ true };
+    ReactorConfig config;
+    config.threads = 1;
+    config.endpoint = endpoint;
+    std::thread server([&] { runEpollServer(listener, config, clientCount, running); });
+
+    LatencyHistogram latencyNs;
+    bool ok = pingPong(endpoint, request, seconds, latencyNs);
+    running = false;
+    server.join();
+    closesocket(listener);
+    removeEndpoint(endpoint);
+
+    auto us = [](uint64_t ns) { return ns / 1000.0; };
+    std::printf("%-22s %12.0f %9.1f %9.1f %9.1f %9.1f%s\n", name, latencyNs.count() / seconds,
+        us(latencyNs.percentile(0.50)), us(latencyNs.percentile(0.99)), us(latencyNs.percentile(0.999)),
+        us(latencyNs.max()), ok ? "" : "  (connection failed)");
+}
+
+int main(int argc, char* argv[]) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 2.0;
+    size_t messageBytes = argc > 2 ? static_cast<size_t>(std::atoi(argv[2])) : 64;
+    if (seconds <= 0 || messageBytes < 1 || messageBytes > MAX_FRAME_PAYLOAD / 2) {
+        std::fprintf(stderr, "Usage: %s [seconds per transport] [message bytes]\n", argv[0]);
+        return 1;
+    }
+
+    // Keep the server's startup and per-connection lines off the terminal
+    std::cout.setstate(std::ios::badbit);
+    setLogLevel(LogLevel::Warning);
+
+    std::string request;
+    appendFrame(request, FrameType::Message, std::string(messageBytes, 'x'));
+
+    std::printf("1 connection, %zu byte messages, %.1f s per transport\n", messageBytes, seconds);
+    std::printf("%-22s %12s %9s %9s %9s %9s\n", "transport", "round trips/s", "p50 us", "p99 us", "p99.9 us", "max us");
+
+    std::string suffix = std::to_string(getpid());
+    Endpoint tcp;
+    tcp.port = 0;
+    Endpoint unixPath;
+    unixPath.transport = Transport::Unix;
+    unixPath.path = "/tmp/ipc-transport-bench-" + suffix + ".sock";
+    Endpoint unixAbstract;
+    unixAbstract.transport = Transport::Unix;
+    unixAbstract.path = "@ipc-transport-bench-" + suffix;
+    Endpoint seqPacket;
+    seqPacket.transport = Transport::SeqPacket;
+    seqPacket.path = "@ipc-transport-bench-seq-" + suffix;
+
+    runTransport("tcp loopback", tcp, request, seconds);
+    runTransport("unix stream", unixPath, request, seconds);
+    runTransport("unix stream abstract", unixAbstract, request, seconds);
+    runTransport("seqpacket abstract", seqPacket, request, seconds);
+    return 0;
+}
@@ -0,0 +1,708 @@
+// uring_server.cpp : io_uring mode for the Server. Each thread owns a ring
+// with a multishot accept on the listener and a multishot recv per client,
+// so a steady connection costs no syscall per message: received data lands
+// in a provided buffer ring and replies go out from registered buffers
+// (zero-copy sends, the only send op taking fixed buffers on 6.x kernels).
+// Uses the raw syscalls, so it doesn't depend on liburing.
+
+#include "uring_server.h"
+#include "server_common.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/utsname.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr unsigned RING_ENTRIES = 1024;
+constexpr unsigned RECV_BUFFERS = 1024;        // Provided receive buffers per ring (power of two)
+constexpr uint16_t RECV_GROUP = 0;
+constexpr unsigned SEND_SLOTS = 1024;          // Registered send buffers per ring
+constexpr size_t SEND_SLOT_SIZE = 2048;
+constexpr size_t MAX_PENDING_OUTPUT = 64 * 1024;  // Stop receiving from a client above this
+
+int uringSetup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int uringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int uringRegister(int fd, unsigned opcode, const void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+// Minimal io_uring instance: the submission and completion rings mapped
+// from the kernel, with the SQ index array set up as an identity map
+class Ring {
+public:
+    explicit Ring(unsigned entries) {
+        io_uring_params params{};
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = entries * 4;  // Multishot ops post many completions each
+        m_fd = uringSetup(entries, &params);
+        if (m_fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "io_uring_setup failed");
+        }
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+            close();
+            throw std::system_error(ENOTSUP, std::generic_category(), "io_uring is too old");
+        }
+
+        size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        m_ringSize = sqSize > cqSize ? sqSize : cqSize;
+        m_ring = mmap(nullptr, m_ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            m_fd, IORING_OFF_SQ_RING);
+        m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            m_fd, IORING_OFF_SQES);
+        if (m_ring == MAP_FAILED || sqes == MAP_FAILED) {
+            int error = errno;
+            if (sqes != MAP_FAILED) {
+                munmap(sqes, m_sqesSize);
+            }
+            if (m_ring == MAP_FAILED) {
+                m_ring = nullptr;
+            }
+            close();
+            throw std::system_error(error, std::generic_category(), "Failed to map io_uring");
+        }
+        m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+        char* base = static_cast<char*>(m_ring);
+        m_sqHead = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+        m_sqTail = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+        m_sqMask = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+        m_sqEntries = params.sq_entries;
+        unsigned* sqArray = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+        for (unsigned i = 0; i < m_sqEntries; ++i) {
+            sqArray[i] = i;
+        }
+        m_cqHead = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+        m_cqTail = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+        m_cqMask = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+        m_localTail = *m_sqTail;
+    }
+
+    ~Ring() { close(); }
+
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    // Tear down the ring, cancelling everything in flight. Buffers handed
+    // to the kernel may only be freed after this.
+    void close() {
+        if (m_sqes != nullptr) {
+            munmap(m_sqes, m_sqesSize);
+            m_sqes = nullptr;
+        }
+        if (m_ring != nullptr) {
+            munmap(m_ring, m_ringSize);
+            m_ring = nullptr;
+        }
+        if (m_fd >= 0) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    int fd() const { return m_fd; }
+
+    // Next submission entry, zeroed. Submits what is queued when full.
+    io_uring_sqe* getSqe() {
+        while (m_localTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries) {
+            submitAndWait(0);
+        }
+        io_uring_sqe* sqe = &m_sqes[m_localTail & m_sqMask];
+        ++m_localTail;
+        std::memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    // Submit queued entries and wait for at least waitFor completions.
+    // Returns a negative errno on failure.
+    int submitAndWait(unsigned waitFor) {
+        __atomic_store_n(m_sqTail, m_localTail, __ATOMIC_RELEASE);
+        unsigned toSubmit = m_localTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+        int result = uringEnter(m_fd, toSubmit, waitFor, waitFor != 0 ? IORING_ENTER_GETEVENTS : 0);
+        return result < 0 ? -errno : result;
+    }
+
+    // Hand every available completion to handler
+    template<typename Handler>
+    void forEachCompletion(Handler&& handler) {
+        unsigned head = *m_cqHead;
+        unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            io_uring_cqe cqe = m_cqes[head & m_cqMask];
+            __atomic_store_n(m_cqHead, head + 1, __ATOMIC_RELEASE);
+            handler(cqe);
+        }
+    }
+
+private:
+    int m_fd = -1;
+    void* m_ring = nullptr;
+    size_t m_ringSize = 0;
+    io_uring_sqe* m_sqes = nullptr;
+    size_t m_sqesSize = 0;
+    unsigned* m_sqHead = nullptr;
+    unsigned* m_sqTail = nullptr;
+    unsigned m_sqMask = 0;
+    unsigned m_sqEntries = 0;
+    unsigned m_localTail = 0;
+    unsigned* m_cqHead = nullptr;
+    unsigned* m_cqTail = nullptr;
+    unsigned m_cqMask = 0;
+    io_uring_cqe* m_cqes = nullptr;
+};
+
+// Receive buffers the kernel picks from for buffer-select recvs
+// (IORING_REGISTER_PBUF_RING). A buffer is recycled once its data is handled.
+class ProvidedBuffers {
+public:
+    ProvidedBuffers(Ring& ring, unsigned count, unsigned size, uint16_t group)
+        : m_count(count), m_size(size), m_data(static_cast<size_t>(count) * size) {
+        m_ringBytes = count * sizeof(io_uring_buf);
+        void* memory = mmap(nullptr, m_ringBytes, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "Failed to map buffer ring");
+        }
+        m_ring = static_cast<io_uring_buf_ring*>(memory);
+
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uint64_t>(m_ring);
+        reg.ring_entries = count;
+        reg.bgid = group;
+        if (uringRegister(ring.fd(), IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+            int error = errno;
+            munmap(m_ring, m_ringBytes);
+            throw std::system_error(error, std::generic_category(), "Failed to register buffer ring");
+        }
+        for (unsigned i = 0; i < count; ++i) {
+            recycle(static_cast<uint16_t>(i));
+        }
+    }
+
+    ~ProvidedBuffers() { munmap(m_ring, m_ringBytes); }
+
+    ProvidedBuffers(const ProvidedBuffers&) = delete;
+    ProvidedBuffers& operator=(const ProvidedBuffers&) = delete;
+
+    const char* data(uint16_t id) const { return m_data.data() + static_cast<size_t>(id) * m_size; }
+
+    void recycle(uint16_t id) {
+        // Entries start at the ring base. Not through m_ring->bufs: in C++ the
+        // uapi flex-array wrapper shifts that member by 8 bytes. Written field
+        // by field, as the ring's tail overlays the first entry's resv.
+        io_uring_buf& buf = reinterpret_cast<io_uring_buf*>(m_ring)[m_tail & (m_count - 1)];
+        buf.addr = reinterpret_cast<uint64_t>(data(id));
+        buf.len = m_size;
+        buf.bid = id;
+        ++m_tail;
+        __atomic_store_n(&m_ring->tail, m_tail, __ATOMIC_RELEASE);
+    }
+
+private:
+    unsigned m_count;
+    unsigned m_size;
+    std::vector<char> m_data;
+    io_uring_buf_ring* m_ring;
+    size_t m_ringBytes;
+    uint16_t m_tail = 0;
+};
+
+enum Operation : uintptr_t {
+    OP_ACCEPT = 1,
+    OP_RECV = 2,
+    OP_SEND = 3,
+    OP_TIMER = 4,
+    OP_CANCEL = 5
+};
+constexpr uint64_t OP_MASK = 7;
+constexpr uint64_t POINTER_MASK = (uint64_t(1) << 48) - 1 - OP_MASK;
+constexpr int SLOT_SHIFT = 48;  // Sends keep their slot + 1 above the pointer
+
+struct alignas(8) Connection {
+    SOCKET socket;
+    int clientId;
+    bool recvArmed = false;
+    bool recvPaused = false;   // Recv cancelled until output drains
+    bool sending = false;
+    bool closing = false;
+    bool closeAfterFlush = false;
+    const char* closeReason = "";
+    FrameParser input;         // Received bytes, parsed into frames in place
+    OutputBuffer pending;      // Output queued behind the send in flight
+    std::string sendHeap;      // Data of the send in flight when it isn't in a slot
+    int sendSlot = -1;         // Registered send slot in use, or -1
+    int notifications = 0;     // Zero-copy sends whose buffer the kernel still holds
+    size_t sendLength = 0;
+    size_t sendOffset = 0;
+    Clock::time_point lastActive;
+    Clock::time_point replyStart;  // When the oldest unsent reply's request arrived
+    ConnectionStats stats;
+};
+
+uint64_t userData(Connection* connection, Operation operation, int slot = -1) {
+    return reinterpret_cast<uintptr_t>(connection) | operation
+        | (static_cast<uint64_t>(slot + 1) << SLOT_SHIFT);
+}
+
+class UringReactor {
+public:
+    UringReactor(SOCKET listenSocket, const ReactorConfig& config, std::atomic<int>& clientCount, int index)
+        : m_ring(RING_ENTRIES)
+        , m_recvBuffers(m_ring, RECV_BUFFERS, BUFFER_SIZE, RECV_GROUP)
+        , m_listenSocket(listenSocket)
+        , m_config(config)
+        , m_clientCount(clientCount)
+        , m_index(index) {
+        m_timer.tv_sec = 1;
+
+        // Registered send buffers are pinned memory and count against
+        // RLIMIT_MEMLOCK; without them sends use ordinary buffers. Zero-copy
+        // sends only exist for TCP.
+        if (config.endpoint.transport != Transport::Tcp) {
+            return;
+        }
+        m_sendArea.resize(SEND_SLOTS * SEND_SLOT_SIZE);
+        iovec area{ m_sendArea.data(), m_sendArea.size() };
+        if (uringRegister(m_ring.fd(), IORING_REGISTER_BUFFERS, &area, 1) == 0) {
+            m_slotRefs.assign(SEND_SLOTS, 0);
+            for (unsigned i = 0; i < SEND_SLOTS; ++i) {
+                m_freeSlots.push_back(static_cast<int>(i));
+            }
+        } else {
+            logWarning("Server: io_uring registered buffers unavailable: ", strerror(errno));
+        }
+    }
+
+    ~UringReactor() {
+        m_ring.close();  // Before the buffers and connections it may still reference go away
+        for (auto& entry : m_connections) {
+            closesocket(entry.second->socket);
+        }
+    }
+
+    UringReactor(const UringReactor&) = delete;
+    UringReactor& operator=(const UringReactor&) = delete;
+
+    void run(const std::atomic<bool>& running) {
+        m_stats = &threadStats();
+        armAccept();
+        armTimer();
+        while (running) {
+            int result = m_ring.submitAndWait(1);
+            if (result < 0 && result != -EINTR && result != -EAGAIN && result != -EBUSY) {
+                logError("Server: io_uring_enter failed: ", strerror(-result));
+                break;
+            }
+            m_ring.forEachCompletion([this](const io_uring_cqe& cqe) { dispatch(cqe); });
+        }
+    }
+
+private:
+    void dispatch(const io_uring_cqe& cqe) {
+        auto operation = static_cast<Operation>(cqe.user_data & OP_MASK);
+        auto* connection = reinterpret_cast<Connection*>(cqe.user_data & POINTER_MASK);
+        switch (operation) {
+        case OP_ACCEPT:
+            onAccept(cqe);
+            break;
+        case OP_RECV:
+            onRecv(*connection, cqe);
+            break;
+        case OP_SEND:
+            onSend(*connection, cqe);
+            break;
+        case OP_TIMER:
+            armTimer();
+            closeIdle();
+            break;
+        case OP_CANCEL:
+            break;
+        }
+    }
+
+    void armAccept() {
+        io_uring_sqe* sqe = m_ring.getSqe();
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = m_listenSocket;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_CLOEXEC;
+        sqe->user_data = userData(nullptr, OP_ACCEPT);
+        m_acceptArmed = true;
+    }
+
+    void armTimer() {
+        io_uring_sqe* sqe = m_ring.getSqe();
+        sqe->opcode = IORING_OP_TIMEOUT;
+        sqe->addr = reinterpret_cast<uint64_t>(&m_timer);
+        sqe->len = 1;
+        sqe->user_data = userData(nullptr, OP_TIMER);
+    }
+
+    void armRecv(Connection& connection) {
+        io_uring_sqe* sqe = m_ring.getSqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = connection.socket;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = RECV_GROUP;
+        sqe->user_data = userData(&connection, OP_RECV);
+        connection.recvArmed = true;
+    }
+
+    void onAccept(const io_uring_cqe& cqe) {
+        if (!(cqe.flags & IORING_CQE_F_MORE)) {
+            m_acceptArmed = false;
+        }
+        if (cqe.res >= 0 && m_clientCount.fetch_add(1) >= m_config.maxConnections) {
+            // Another ring's multishot accept took the last slot while this
+            // one's was still armed
+            --m_clientCount;
+            closesocket(cqe.res);
+        } else if (cqe.res >= 0) {
+            auto connection = std::make_unique<Connection>();
+            connection->socket = cqe.res;
+            // Ids are unique without sharing a counter between rings
+            connection->clientId = m_index + 1 + m_accepted++ * m_config.threads;
+            connection->lastActive = Clock::now();
+            m_stats->accepted();
+            logInfo("Server: Client #", connection->clientId, " connected! (Total clients: ", m_clientCount, ")");
+            armRecv(*connection);
+            m_connections.emplace(connection->socket, std::move(connection));
+        } else if (cqe.res != -ECANCELED) {
+            logError("Server: Accept failed. Error: ", strerror(-cqe.res));
+        }
+
+        if (m_clientCount >= m_config.maxConnections) {
+            // Leave further connections in the listen backlog until one closes
+            if (m_acceptArmed) {
+                io_uring_sqe* sqe = m_ring.getSqe();
+                sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                sqe->addr = userData(nullptr, OP_ACCEPT);
+                sqe->user_data = userData(nullptr, OP_CANCEL);
+            }
+            if (!m_acceptPaused) {
+                ServerStats::instance().acceptPaused();
+            }
+            m_acceptPaused = true;
+        } else if (!m_acceptArmed) {
+            armAccept();
+        }
+    }
+
+    void onRecv(Connection& connection, const io_uring_cqe& cqe) {
+        if (!(cqe.flags & IORING_CQE_F_MORE)) {
+            connection.recvArmed = false;
+        }
+
+        if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+            auto id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            if (!connection.closing && !connection.closeAfterFlush) {
+                connection.lastActive = Clock::now();
+                m_stats->received(connection.stats, static_cast<size_t>(cqe.res));
+                if (connection.pending.empty() && !connection.sending) {
+                    connection.replyStart = connection.lastActive;
+                }
+                // Data that was already on its way when recv was paused
+                // waits in the input buffer
+                connection.input.append(m_recvBuffers.data(id), static_cast<size_t>(cqe.res));
+                if (!connection.recvPaused) {
+                    onInput(connection);
+                }
+            }
+            m_recvBuffers.recycle(id);
+        } else if (cqe.res == 0) {
+            beginClose(connection, "closed connection gracefully");
+        } else if (cqe.res < 0 && cqe.res != -ENOBUFS && cqe.res != -ECANCELED) {
+            beginClose(connection, cqe.res == -ECONNRESET ? "connection reset by peer" : "receive error");
+        }
+
+        // Multishot recv ends on errors and when the buffer ring ran dry
+        if (!connection.recvArmed && !connection.closing && !connection.recvPaused) {
+            armRecv(connection);
+        }
+        releaseIfDone(connection);
+    }
+
+    // Answer what was received, then stop receiving if the client isn't
+    // reading its replies: the rest stays in the kernel (TCP backpressure)
+    // until the output drains
+    void onInput(Connection& connection) {
+        handleFrames(connection);
+        if (connection.closing || connection.closeAfterFlush || outputBacklog(connection) <= MAX_PENDING_OUTPUT) {
+            return;
+        }
+        connection.recvPaused = true;
+        m_stats->backpressure();
+        if (connection.recvArmed) {
+            io_uring_sqe* sqe = m_ring.getSqe();
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->addr = userData(&connection, OP_RECV);
+            sqe->user_data = userData(nullptr, OP_CANCEL);
+        }
+    }
+
+    // Replies not yet taken by the socket
+    static size_t outputBacklog(const Connection& connection) {
+        return connection.pending.size()
+            + (connection.sending ? connection.sendLength - connection.sendOffset : 0);
+    }
+
+    // Answer every complete frame received so far
+    void handleFrames(Connection& connection) {
+        Frame frame;
+        FrameParser::Status status;
+        while ((status = connection.input.next(frame)) == FrameParser::Status::Complete) {
+            MessageResult result = handleMessage(connection.clientId, frame, connection.pending, connection.stats);
+            if (result == MessageResult::Quit) {
+                connection.closeAfterFlush = true;
+                break;
+            }
+        }
+        if (status == FrameParser::Status::Invalid) {
+            beginClose(connection, "sent a malformed frame");
+            return;
+        }
+        if (connection.sending) {
+            // Its completion picks up pending output, after the input
+            // buffer has been reused
+            connection.pending.detach();
+            return;
+        }
+        if (!connection.pending.empty()) {
+            startSend(connection);
+        } else if (connection.closeAfterFlush) {
+            beginClose(connection, "disconnected");
+        }
+    }
+
+    // Move pending output into the send in flight, preferring a registered slot
+    void startSend(Connection& connection) {
+        connection.sendLength = connection.pending.size();
+        connection.sendOffset = 0;
+        if (connection.sendLength <= SEND_SLOT_SIZE && !m_freeSlots.empty()) {
+            connection.sendSlot = m_freeSlots.back();
+            m_freeSlots.pop_back();
+            m_slotRefs[connection.sendSlot] = 1;
+            connection.pending.moveTo(slotData(connection.sendSlot));
+        } else {
+            connection.sendHeap.resize(connection.sendLength);
+            connection.pending.moveTo(connection.sendHeap.data());
+        }
+        submitSend(connection);
+    }
+
+    void submitSend(Connection& connection) {
+        const char* data = connection.sendSlot >= 0 ? slotData(connection.sendSlot) : connection.sendHeap.data();
+        io_uring_sqe* sqe = m_ring.getSqe();
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = connection.socket;
+        sqe->addr = reinterpret_cast<uint64_t>(data + connection.sendOffset);
+        sqe->len = static_cast<uint32_t>(connection.sendLength - connection.sendOffset);
+        sqe->msg_flags = MSG_NOSIGNAL;
+        if (connection.sendSlot >= 0) {
+            // The slot stays referenced until the kernel's notification
+            sqe->opcode = IORING_OP_SEND_ZC;
+            sqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+            sqe->buf_index = 0;
+            ++m_slotRefs[connection.sendSlot];
+        }
+        sqe->user_data = userData(&connection, OP_SEND, connection.sendSlot);
+        connection.sending = true;
+    }
+
+    void onSend(Connection& connection, const io_uring_cqe& cqe) {
+        int slot = static_cast<int>(cqe.user_data >> SLOT_SHIFT) - 1;
+        if (cqe.flags & IORING_CQE_F_NOTIF) {
+            // Zero-copy send done with its buffer
+            --connection.notifications;
+            releaseSlot(slot);
+            releaseIfDone(connection);
+            return;
+        }
+        if (slot >= 0) {
+            if (cqe.flags & IORING_CQE_F_MORE) {
+                ++connection.notifications;
+            } else {
+                releaseSlot(slot);  // Failed before taking the buffer
+            }
+        }
+
+        connection.sending = false;
+        if (cqe.res < 0) {
+            beginClose(connection, "send error");
+        } else {
+            m_stats->sent(connection.stats, static_cast<size_t>(cqe.res));
+            connection.sendOffset += static_cast<size_t>(cqe.res);
+            if (connection.sendOffset < connection.sendLength && !connection.closing) {
+                submitSend(connection);  // Partial send: resume with the rest
+                return;
+            }
+        }
+
+        if (connection.sendSlot >= 0) {
+            releaseSlot(connection.sendSlot);
+            connection.sendSlot = -1;
+        }
+        connection.sendHeap.clear();
+
+        if (!connection.closing) {
+            if (!connection.pending.empty()) {
+                startSend(connection);
+            } else {
+                m_stats->latency(Clock::now() - connection.replyStart);
+                if (connection.closeAfterFlush) {
+                    beginClose(connection, "disconnected");
+                }
+            }
+        }
+        if (connection.recvPaused && !connection.closing && outputBacklog(connection) <= MAX_PENDING_OUTPUT) {
+            // Answer what arrived while paused; that may pause it again
+            connection.recvPaused = false;
+            onInput(connection);
+            if (!connection.recvArmed && !connection.closing && !connection.recvPaused) {
+                armRecv(connection);
+            }
+        }
+        releaseIfDone(connection);
+    }
+
+    // Shutting the socket down completes the armed recv, so the connection
+    // is released once no operation references it
+    void beginClose(Connection& connection, const char* reason) {
+        if (connection.closing) {
+            return;
+        }
+        connection.closing = true;
+        connection.closeReason = reason;
+        shutdown(connection.socket, SHUT_RDWR);
+    }
+
+    void releaseIfDone(Connection& connection) {
+        if (!connection.closing || connection.recvArmed || connection.sending
+            || connection.notifications != 0) {
+            return;
+        }
+        int clientId = connection.clientId;
+        const char* reason = connection.closeReason;
+        if (connection.sendSlot >= 0) {
+            releaseSlot(connection.sendSlot);
+        }
+        SOCKET socket = connection.socket;
+        m_stats->closed();
+        logConnectionStats(clientId, connection.stats);
+        closesocket(socket);
+        m_connections.erase(socket);  // Destroys connection
+        --m_clientCount;
+        logInfo("Server: Client #", clientId, " ", reason, " (Remaining clients: ", m_clientCount, ")");
+
+        if (m_acceptPaused && m_clientCount < m_config.maxConnections) {
+            m_acceptPaused = false;
+            if (!m_acceptArmed) {
+                armAccept();
+            }
+        }
+    }
+
+    void closeIdle() {
+        auto deadline = Clock::now() - std::chrono::seconds(m_config.idleTimeoutSeconds);
+        for (auto& entry : m_connections) {
+            if (entry.second->lastActive < deadline) {
+                beginClose(*entry.second, "connection timed out");
+            }
+        }
+    }
+
+    void releaseSlot(int slot) {
+        if (--m_slotRefs[slot] == 0) {
+            m_freeSlots.push_back(slot);
+        }
+    }
+
+    char* slotData(int slot) { return m_sendArea.data() + static_cast<size_t>(slot) * SEND_SLOT_SIZE; }
+
+    Ring m_ring;
+    ProvidedBuffers m_recvBuffers;
+    StatsSlot* m_stats = nullptr;  // The ring thread's, set by run()
+    std::vector<char> m_sendArea;
+    std::vector<int> m_freeSlots;
+    std::vector<uint16_t> m_slotRefs;  // Owner plus zero-copy sends not yet notified
+    __kernel_timespec m_timer{};
+    SOCKET m_listenSocket;
+    const ReactorConfig& m_config;
+    std::atomic<int>& m_clientCount;
+    int m_index;
+    int m_accepted = 0;
+    bool m_acceptArmed = false;
+    bool m_acceptPaused = false;
+    std::unordered_map<SOCKET, std::unique_ptr<Connection>> m_connections;
+};
+
+} // namespace
+
+bool uringAvailable(std::string& reason) {
+    // Multishot recv and sends from registered buffers need 6.0
+    utsname name;
+    int major = 0;
+    int minor = 0;
+    if (uname(&name) != 0 || std::sscanf(name.release, "%d.%d", &major, &minor) != 2
+        || major < 6) {
+        reason = "kernel older than 6.0";
+        return false;
+    }
+    try {
+        Ring ring(8);
+        ProvidedBuffers buffers(ring, 8, 64, RECV_GROUP);
+    } catch (const std::exception& ex) {
+        reason = ex.what();
+        return false;
+    }
+    return true;
+}
+
+int runUringServer(SOCKET listenSocket, const ReactorConfig& config,
+                   std::atomic<int>& clientCount, const std::atomic<bool>& running) {
+    std::vector<std::unique_ptr<UringReactor>> reactors;
+    try {
+        for (int i = 0; i < config.threads; ++i) {
+            reactors.push_back(std::make_unique<UringReactor>(listenSocket, config, clientCount, i));
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Server: Failed to start io_uring reactors: " << ex.what() << std::endl;
+        return 1;
+    }
+    std::cout << "Server: io_uring mode with " << config.threads << " rings" << std::endl;
+
+    ServerStats::instance().watchListener(listenSocket);
+    std::vector<std::thread> threads;
+    for (auto& reactor : reactors) {
+        UringReactor* ring = reactor.get();
+        threads.emplace_back([ring, &running] { ring->run(running); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ServerStats::instance().unwatchListener(listenSocket);
+    return 0;
+}
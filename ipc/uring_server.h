@@ -0,0 +1,17 @@
+#pragma once
+
+// io_uring mode for the Server (Linux 6.0+): multishot accept, multishot
+// recv into a provided buffer ring and sends from registered buffers
+
+#include "epoll_server.h"
+#include <string>
+
+// Whether this kernel supports everything the io_uring mode needs; if not,
+// reason says why
+bool uringAvailable(std::string& reason);
+
+// Serve clients on listenSocket until running becomes false, with one ring
+// per config.threads. All rings accept on the same listener. Returns the
+// process exit code.
+int runUringServer(SOCKET listenSocket, const ReactorConfig& config,
+                   std::atomic<int>& clientCount, const std::atomic<bool>& running);
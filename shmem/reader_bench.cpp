@@ -0,0 +1,147 @@
+// reader_bench.cpp : Reader throughput of ExclusiveLock vs SharedLock
+// with 1..N reader processes and one writer updating at a fixed rate.
+//
+
+#include "shmem.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+
+// Not trivially copyable (atomic member), so SeqLock is not an option
+struct Payload {
+    std::atomic<uint64_t> updates{ 0 };
+    uint64_t values[1024];
+};
+
+using Clock = std::chrono::steady_clock;
+
+constexpr auto RUN_TIME = std::chrono::milliseconds(500);
+constexpr auto WRITE_INTERVAL = std::chrono::microseconds(500);
+
+struct Result {
+    double readsPerSecond;
+    uint64_t writes;
+};
+
+// Reader process: read until the deadline and report the count on the pipe
+template<typename Policy>
+[[noreturn]] void runReader(const char* name, Clock::time_point start, int fd) {
+    uint64_t reads = 0;
+    try {
+        LocalSharedMemory<Payload, Policy> shmem(name, false);
+        while (Clock::now() < start) {
+            std::this_thread::yield();
+        }
+        volatile uint64_t sink = 0;
+        while (Clock::now() < start + RUN_TIME) {
+            sink = shmem.Read([](const Payload& data) {
+                uint64_t sum = 0;
+                for (uint64_t value : data.values) {
+                    sum = (sum ^ value) * 0x100000001b3ull;
+                }
+                return sum;
+            });
+            ++reads;
+        }
+        (void)sink;
+    } catch (const std::exception& ex) {
+        std::fprintf(stderr, "Reader error: %s\n", ex.what());
+    }
+    ssize_t written = write(fd, &reads, sizeof(reads));
+    _exit(written == sizeof(reads) ? 0 : 1);
+}
+
+template<typename Policy>
+Result runBenchmark(const char* name, int readers) {
+    LocalSharedMemory<Payload, Policy> shmem(name, true);
+
+    int fds[2];
+    if (pipe(fds) == -1) {
+        throw std::system_error(errno, std::generic_category(), "Failed to create pipe");
+    }
+
+    auto start = Clock::now() + std::chrono::milliseconds(100);
+    std::vector<pid_t> children;
+    for (int i = 0; i < readers; ++i) {
+        pid_t pid = fork();
+        if (pid == -1) {
+            throw std::system_error(errno, std::generic_category(), "Failed to fork reader");
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            runReader<Policy>(name, start, fds[1]);
+        }
+        children.push_back(pid);
+    }
+    close(fds[1]);
+
+    // Writer: the main process updates the payload at a fixed rate
+    uint64_t writes = 0;
+    while (Clock::now() < start) {
+        std::this_thread::yield();
+    }
+    auto next = start;
+    while (Clock::now() < start + RUN_TIME) {
+        shmem.Write([](Payload& data) {
+            uint64_t update = data.updates.fetch_add(1, std::memory_order_relaxed) + 1;
+            for (uint64_t& value : data.values) {
+                value = update;
+            }
+        });
+        ++writes;
+        next += WRITE_INTERVAL;
+        std::this_thread::sleep_until(next);
+    }
+
+    uint64_t totalReads = 0;
+    for (size_t i = 0; i < children.size(); ++i) {
+        uint64_t reads = 0;
+        if (read(fds[0], &reads, sizeof(reads)) == sizeof(reads)) {
+            totalReads += reads;
+        }
+    }
+    close(fds[0]);
+    for (pid_t pid : children) {
+        waitpid(pid, nullptr, 0);
+    }
+
+    double seconds = std::chrono::duration<double>(RUN_TIME).count();
+    return { totalReads / seconds, writes };
+}
+
+int main(int argc, char* argv[])
+{
+    int maxReaders = argc > 1 ? std::atoi(argv[1])
+                              : static_cast<int>(std::thread::hardware_concurrency());
+    if (maxReaders < 1) {
+        maxReaders = 1;
+    }
+
+    try {
+        std::printf("%8s  %16s %8s  %16s %8s\n", "readers",
+            "exclusive rd/s", "writes", "shared rd/s", "writes");
+        std::vector<int> counts;
+        for (int readers = 1; readers < maxReaders; readers *= 2) {
+            counts.push_back(readers);
+        }
+        counts.push_back(maxReaders);
+
+        for (int readers : counts) {
+            Result exclusive = runBenchmark<ExclusiveLock>("Local\\ReaderBenchExclusive", readers);
+            Result shared = runBenchmark<SharedLock<true>>("Local\\ReaderBenchShared", readers);
+            std::printf("%8d  %16.0f %8llu  %16.0f %8llu\n", readers,
+                exclusive.readsPerSecond, static_cast<unsigned long long>(exclusive.writes),
+                shared.readsPerSecond, static_cast<unsigned long long>(shared.writes));
+        }
+    }
+    catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
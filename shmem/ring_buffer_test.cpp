@@ -0,0 +1,52 @@
+// ring_buffer_test.cpp : Edge cases of SharedRingBuffer batch operations.
+// Exits non-zero on the first failed check.
+//
+
+#include "shared_ring_buffer.h"
+#include <cstdio>
+#include <memory>
+
+#define CHECK(condition)                                                   \
+    do {                                                                   \
+        if (!(condition)) {                                                \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__,    \
+                __LINE__, #condition);                                     \
+            return false;                                                  \
+        }                                                                  \
+    } while (false)
+
+// Zero-length batches return 0 whether the ring is empty, part full or
+// full, and leave its contents alone
+template<typename Mode>
+bool zeroLengthBatches() {
+    constexpr size_t kCapacity = 8;
+    auto ring = std::make_unique<SharedRingBuffer<int, kCapacity, Mode>>();
+    int items[kCapacity] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    int out[kCapacity] = {};
+
+    CHECK(ring->PushBatch(items, 0) == 0);
+    CHECK(ring->PopBatch(out, 0) == 0);
+
+    CHECK(ring->PushBatch(items, 3) == 3);
+    CHECK(ring->PushBatch(items, 0) == 0);
+    CHECK(ring->PopBatch(out, 0) == 0);
+    CHECK(ring->Size() == 3);
+
+    CHECK(ring->PushBatch(items + 3, kCapacity - 3) == kCapacity - 3);
+    CHECK(ring->PushBatch(items, 0) == 0);
+    CHECK(ring->PopBatch(out, 0) == 0);
+
+    CHECK(ring->PopBatch(out, kCapacity) == kCapacity);
+    for (size_t i = 0; i < kCapacity; ++i) {
+        CHECK(out[i] == items[i]);
+    }
+    CHECK(ring->PopBatch(out, 0) == 0);
+    return true;
+}
+
+int main()
+{
+    bool passed = zeroLengthBatches<SpscRing>() && zeroLengthBatches<MpmcRing>();
+    std::printf("%s\n", passed ? "All ring buffer checks passed" : "Ring buffer checks failed");
+    return passed ? 0 : 1;
+}
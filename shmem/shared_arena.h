@@ -0,0 +1,392 @@
+// shared_arena.h : Allocator for variable-sized data inside a LocalSharedMemory
+// segment. Pointers into the arena are stored as OffsetPtr (self-relative), so
+// containers built on ArenaAllocator work at any mapping address, e.g.
+//
+//   using Arena = SharedArena<64 * 1024 * 1024>;
+//   LocalSharedMemory<Arena> shmem("Local\\Arena", true);
+//   Arena& arena = shmem.GetUnlocked();
+//   auto* names = arena.Construct<ArenaVector<ArenaString>>(arena.GetAllocator<ArenaString>());
+//   arena.SetRoot(names);
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Self-relative pointer: stores the distance from its own address to the
+// target, so it stays valid wherever the segment is mapped. Copying
+// recomputes the distance for the new location.
+template<typename T>
+class OffsetPtr {
+public:
+    using element_type = T;
+    using value_type = std::remove_cv_t<T>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = OffsetPtr;
+    using reference = std::add_lvalue_reference_t<T>;
+    using iterator_category = std::random_access_iterator_tag;
+
+    template<typename U>
+    using rebind = OffsetPtr<U>;
+
+    OffsetPtr() noexcept : m_offset(kNull) {}
+    OffsetPtr(std::nullptr_t) noexcept : m_offset(kNull) {}
+    OffsetPtr(T* ptr) noexcept { Set(ptr); }
+    OffsetPtr(const OffsetPtr& other) noexcept { Set(other.get()); }
+
+    template<typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    OffsetPtr(const OffsetPtr<U>& other) noexcept { Set(other.get()); }
+
+    OffsetPtr& operator=(const OffsetPtr& other) noexcept { Set(other.get()); return *this; }
+    OffsetPtr& operator=(T* ptr) noexcept { Set(ptr); return *this; }
+    OffsetPtr& operator=(std::nullptr_t) noexcept { m_offset = kNull; return *this; }
+
+    T* get() const noexcept {
+        if (m_offset == kNull) {
+            return nullptr;
+        }
+        return reinterpret_cast<T*>(Address(this) + m_offset);
+    }
+
+    reference operator*() const noexcept { return *get(); }
+    T* operator->() const noexcept { return get(); }
+    reference operator[](difference_type i) const noexcept { return get()[i]; }
+    explicit operator bool() const noexcept { return m_offset != kNull; }
+
+    static OffsetPtr pointer_to(reference ref) noexcept { return OffsetPtr(std::addressof(ref)); }
+
+    OffsetPtr& operator+=(difference_type n) noexcept { Set(get() + n); return *this; }
+    OffsetPtr& operator-=(difference_type n) noexcept { Set(get() - n); return *this; }
+    OffsetPtr& operator++() noexcept { return *this += 1; }
+    OffsetPtr& operator--() noexcept { return *this -= 1; }
+    OffsetPtr operator++(int) noexcept { OffsetPtr old(*this); ++*this; return old; }
+    OffsetPtr operator--(int) noexcept { OffsetPtr old(*this); --*this; return old; }
+
+    friend OffsetPtr operator+(const OffsetPtr& p, difference_type n) noexcept { return OffsetPtr(p.get() + n); }
+    friend OffsetPtr operator+(difference_type n, const OffsetPtr& p) noexcept { return OffsetPtr(p.get() + n); }
+    friend OffsetPtr operator-(const OffsetPtr& p, difference_type n) noexcept { return OffsetPtr(p.get() - n); }
+    friend difference_type operator-(const OffsetPtr& a, const OffsetPtr& b) noexcept { return a.get() - b.get(); }
+
+    friend bool operator==(const OffsetPtr& a, const OffsetPtr& b) noexcept { return a.get() == b.get(); }
+    friend bool operator!=(const OffsetPtr& a, const OffsetPtr& b) noexcept { return a.get() != b.get(); }
+    friend bool operator<(const OffsetPtr& a, const OffsetPtr& b) noexcept { return a.get() < b.get(); }
+    friend bool operator>(const OffsetPtr& a, const OffsetPtr& b) noexcept { return a.get() > b.get(); }
+    friend bool operator<=(const OffsetPtr& a, const OffsetPtr& b) noexcept { return a.get() <= b.get(); }
+    friend bool operator>=(const OffsetPtr& a, const OffsetPtr& b) noexcept { return a.get() >= b.get(); }
+    friend bool operator==(const OffsetPtr& a, std::nullptr_t) noexcept { return !a; }
+    friend bool operator!=(const OffsetPtr& a, std::nullptr_t) noexcept { return static_cast<bool>(a); }
+
+private:
+    // Distance 1 can't point at a T (it would overlap this object), so it
+    // marks null; 0 would be a valid self-reference
+    static constexpr std::ptrdiff_t kNull = 1;
+
+    // Integer arithmetic rather than char* arithmetic: the target is not
+    // part of this object, and the optimizer may assume pointer arithmetic
+    // stays within it
+    static std::uintptr_t Address(const volatile void* ptr) noexcept {
+        return reinterpret_cast<std::uintptr_t>(ptr);
+    }
+
+    void Set(T* ptr) noexcept {
+        m_offset = ptr == nullptr ? kNull
+            : static_cast<std::ptrdiff_t>(Address(ptr) - Address(this));
+    }
+
+    std::ptrdiff_t m_offset;
+};
+
+// Allocator state shared by every SharedArena size. Blocks are rounded up
+// to a power of two; freed blocks go onto a lock-free free list for their
+// size class and everything else comes from a bump pointer.
+class SharedArenaBase {
+public:
+    static constexpr size_t kMinBlock = 16;  // Also the alignment of every block
+
+    SharedArenaBase(const SharedArenaBase&) = delete;
+    SharedArenaBase& operator=(const SharedArenaBase&) = delete;
+
+    // Returns nullptr when the arena is exhausted
+    void* Allocate(size_t size) {
+        unsigned sizeClass = SizeClass(size);
+        if (sizeClass >= kClasses) {
+            return nullptr;
+        }
+        if (void* block = PopFree(sizeClass)) {
+            return block;
+        }
+        const uint64_t blockSize = uint64_t(1) << sizeClass;
+        uint64_t top = m_top.load(std::memory_order_relaxed);
+        do {
+            if (top + blockSize > m_capacity) {
+                return nullptr;
+            }
+        } while (!m_top.compare_exchange_weak(top, top + blockSize, std::memory_order_relaxed));
+        return HeapBase() + top;
+    }
+
+    // size must match the size passed to Allocate
+    void Deallocate(void* block, size_t size) {
+        if (block != nullptr) {
+            PushFree(SizeClass(size), block);
+        }
+    }
+
+    template<typename U, typename... Args>
+    U* Construct(Args&&... args) {
+        static_assert(alignof(U) <= kMinBlock, "Arena blocks are 16-byte aligned");
+        void* block = Allocate(sizeof(U));
+        if (block == nullptr) {
+            throw std::bad_alloc();
+        }
+        return new (block) U(std::forward<Args>(args)...);
+    }
+
+    template<typename U>
+    void Destroy(U* object) {
+        if (object != nullptr) {
+            object->~U();
+            Deallocate(object, sizeof(U));
+        }
+    }
+
+    // Well-known object other processes start from
+    template<typename U>
+    void SetRoot(U* object) {
+        m_root.store(object == nullptr ? 0 : ToOffset(object), std::memory_order_release);
+    }
+
+    template<typename U>
+    U* GetRoot() const {
+        uint64_t offset = m_root.load(std::memory_order_acquire);
+        return offset == 0 ? nullptr : static_cast<U*>(FromOffset(offset));
+    }
+
+    template<typename U>
+    auto GetAllocator();
+
+    size_t Capacity() const { return static_cast<size_t>(m_capacity); }
+    size_t BytesReserved() const { return static_cast<size_t>(m_top.load(std::memory_order_relaxed)); }
+
+protected:
+    explicit SharedArenaBase(uint64_t capacity)
+        : m_capacity(capacity)
+        , m_top(kMinBlock)  // Offset 0 is reserved so it can mean null
+        , m_root(0)
+    {
+        for (auto& head : m_freeLists) {
+            head.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    // Free-list heads pack an ABA tag above the block offset (in 16-byte units)
+    static constexpr unsigned kClasses = 40;
+    static constexpr unsigned kOffsetBits = 40;
+    static constexpr uint64_t kOffsetMask = (uint64_t(1) << kOffsetBits) - 1;
+
+    static unsigned SizeClass(size_t size) {
+        unsigned sizeClass = 4;  // log2(kMinBlock)
+        while ((size_t(1) << sizeClass) < size && sizeClass < kClasses) {
+            ++sizeClass;
+        }
+        return sizeClass;
+    }
+
+    // The heap starts right after this header (see SharedArena)
+    char* HeapBase() const {
+        return const_cast<char*>(reinterpret_cast<const char*>(this)) + sizeof(SharedArenaBase);
+    }
+
+    uint64_t ToOffset(const void* ptr) const {
+        return static_cast<uint64_t>(static_cast<const char*>(ptr) - HeapBase());
+    }
+
+    void* FromOffset(uint64_t offset) const {
+        return HeapBase() + offset;
+    }
+
+    void PushFree(unsigned sizeClass, void* block) {
+        auto& head = m_freeLists[sizeClass];
+        auto* next = static_cast<std::atomic<uint64_t>*>(block);
+        uint64_t units = ToOffset(block) / kMinBlock;
+        uint64_t current = head.load(std::memory_order_relaxed);
+        uint64_t desired;
+        do {
+            next->store(current & kOffsetMask, std::memory_order_relaxed);
+            desired = (((current >> kOffsetBits) + 1) << kOffsetBits) | units;
+        } while (!head.compare_exchange_weak(current, desired,
+            std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    void* PopFree(unsigned sizeClass) {
+        auto& head = m_freeLists[sizeClass];
+        uint64_t current = head.load(std::memory_order_acquire);
+        for (;;) {
+            uint64_t units = current & kOffsetMask;
+            if (units == 0) {
+                return nullptr;
+            }
+            void* block = FromOffset(units * kMinBlock);
+            // May read a block another process just popped; the tag makes
+            // the CAS fail in that case
+            uint64_t next = static_cast<std::atomic<uint64_t>*>(block)->load(std::memory_order_relaxed);
+            uint64_t desired = (((current >> kOffsetBits) + 1) << kOffsetBits) | next;
+            if (head.compare_exchange_weak(current, desired,
+                std::memory_order_acquire, std::memory_order_acquire)) {
+                return block;
+            }
+        }
+    }
+
+    const uint64_t m_capacity;
+    alignas(64) std::atomic<uint64_t> m_top;
+    alignas(64) std::atomic<uint64_t> m_root;
+    std::atomic<uint64_t> m_freeLists[kClasses];
+};
+
+// Arena with HeapBytes of heap, meant to be the payload of a
+// LocalSharedMemory segment. Only the header is touched on construction, so
+// untouched heap pages are never faulted in.
+template<size_t HeapBytes>
+class SharedArena : public SharedArenaBase {
+public:
+    SharedArena() : SharedArenaBase(HeapBytes) {}
+
+private:
+    char m_heap[HeapBytes];
+};
+
+// Standard allocator over a SharedArena. The arena reference is itself an
+// OffsetPtr, so containers holding the allocator can live in the arena.
+template<typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+    using pointer = OffsetPtr<T>;
+    using const_pointer = OffsetPtr<const T>;
+    using void_pointer = OffsetPtr<void>;
+    using const_void_pointer = OffsetPtr<const void>;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    template<typename U>
+    struct rebind { using other = ArenaAllocator<U>; };
+
+    explicit ArenaAllocator(SharedArenaBase& arena) noexcept : m_arena(&arena) {}
+    ArenaAllocator(const ArenaAllocator& other) noexcept : m_arena(other.m_arena) {}
+
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : m_arena(other.Arena()) {}
+
+    ArenaAllocator& operator=(const ArenaAllocator& other) noexcept {
+        m_arena = other.m_arena;
+        return *this;
+    }
+
+    pointer allocate(size_type n) {
+        static_assert(alignof(T) <= SharedArenaBase::kMinBlock, "Arena blocks are 16-byte aligned");
+        if (n > std::numeric_limits<size_type>::max() / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        void* block = m_arena->Allocate(n * sizeof(T));
+        if (block == nullptr) {
+            throw std::bad_alloc();
+        }
+        return pointer(static_cast<T*>(block));
+    }
+
+    void deallocate(pointer p, size_type n) noexcept {
+        m_arena->Deallocate(p.get(), n * sizeof(T));
+    }
+
+    SharedArenaBase* Arena() const noexcept { return m_arena.get(); }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept { return Arena() == other.Arena(); }
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const noexcept { return Arena() != other.Arena(); }
+
+private:
+    OffsetPtr<SharedArenaBase> m_arena;
+};
+
+template<typename U>
+auto SharedArenaBase::GetAllocator() {
+    return ArenaAllocator<U>(*this);
+}
+
+// Containers whose storage lives in the arena
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+// Null-terminated string stored in the arena. std::basic_string can't be
+// used here because libstdc++ doesn't support fancy pointers in it.
+class ArenaString {
+public:
+    using allocator_type = ArenaAllocator<char>;
+
+    explicit ArenaString(const allocator_type& alloc)
+        : m_chars(1, '\0', alloc) {}
+
+    ArenaString(std::string_view text, const allocator_type& alloc)
+        : m_chars(alloc)
+    {
+        assign(text);
+    }
+
+    ArenaString(const ArenaString& other, const allocator_type& alloc)
+        : ArenaString(other.view(), alloc) {}
+
+    // A moved-from string has no buffer at all rather than a lone '\0'
+    // (putting one back could need arena space and throw); the accessors
+    // treat that as the empty string
+    ArenaString(const ArenaString&) = default;
+    ArenaString(ArenaString&&) noexcept = default;
+    ArenaString& operator=(const ArenaString&) = default;
+    ArenaString& operator=(ArenaString&&) noexcept = default;
+
+    ArenaString& operator=(std::string_view text) {
+        assign(text);
+        return *this;
+    }
+
+    void assign(std::string_view text) {
+        m_chars.clear();
+        m_chars.reserve(text.size() + 1);
+        m_chars.insert(m_chars.end(), text.begin(), text.end());
+        m_chars.push_back('\0');
+    }
+
+    void append(std::string_view text) {
+        if (m_chars.empty()) {
+            return assign(text);
+        }
+        m_chars.insert(m_chars.end() - 1, text.begin(), text.end());
+    }
+
+    const char* c_str() const { return m_chars.empty() ? "" : m_chars.data(); }
+    size_t size() const { return m_chars.empty() ? 0 : m_chars.size() - 1; }
+    bool empty() const { return size() == 0; }
+    std::string_view view() const { return std::string_view(c_str(), size()); }
+    operator std::string_view() const { return view(); }
+
+    allocator_type get_allocator() const { return m_chars.get_allocator(); }
+
+    friend bool operator==(const ArenaString& a, std::string_view b) { return a.view() == b; }
+    friend bool operator<(const ArenaString& a, const ArenaString& b) { return a.view() < b.view(); }
+
+private:
+    ArenaVector<char> m_chars;
+};
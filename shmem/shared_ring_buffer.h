@@ -0,0 +1,216 @@
+// shared_ring_buffer.h : Lock-free bounded ring buffers meant to live inside a
+// LocalSharedMemory segment, e.g.
+//
+//   LocalSharedMemory<SharedRingBuffer<Message, 4096>> ring("Local\\Ring", true);
+//   ring.GetUnlocked().TryPush(message);
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Ring buffer modes
+struct SpscRing {};  // One producer and one consumer process/thread
+struct MpmcRing {};  // Any number of producers and consumers
+
+namespace shmem_detail {
+constexpr size_t kCacheLine = 64;
+} // namespace shmem_detail
+
+template<typename T, size_t N, typename Mode = SpscRing>
+class SharedRingBuffer;
+
+// Single-producer/single-consumer ring. Each side owns one cache line holding
+// its own position plus a cached copy of the other side's, so the shared
+// line is only touched when the cache says the ring looks full/empty.
+template<typename T, size_t N>
+class SharedRingBuffer<T, N, SpscRing> {
+    static_assert(std::is_trivially_copyable_v<T>, "Ring elements must be trivially copyable");
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "Ring capacity must be a power of two");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Ring positions must be lock-free");
+
+public:
+    SharedRingBuffer() = default;
+    SharedRingBuffer(const SharedRingBuffer&) = delete;
+    SharedRingBuffer& operator=(const SharedRingBuffer&) = delete;
+
+    static constexpr size_t Capacity() { return N; }
+
+    bool TryPush(const T& item) {
+        return PushBatch(&item, 1) == 1;
+    }
+
+    bool TryPop(T& item) {
+        return PopBatch(&item, 1) == 1;
+    }
+
+    // Push up to count items, returns how many fit
+    size_t PushBatch(const T* items, size_t count) {
+        uint64_t tail = m_producer.tail.load(std::memory_order_relaxed);
+        size_t free = N - static_cast<size_t>(tail - m_producer.cachedHead);
+        if (free < count) {
+            m_producer.cachedHead = m_consumer.head.load(std::memory_order_acquire);
+            free = N - static_cast<size_t>(tail - m_producer.cachedHead);
+        }
+        size_t n = count < free ? count : free;
+        for (size_t i = 0; i < n; ++i) {
+            m_slots[(tail + i) & (N - 1)] = items[i];
+        }
+        if (n != 0) {
+            m_producer.tail.store(tail + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+    // Pop up to max items into out, returns how many were available
+    size_t PopBatch(T* out, size_t max) {
+        uint64_t head = m_consumer.head.load(std::memory_order_relaxed);
+        size_t available = static_cast<size_t>(m_consumer.cachedTail - head);
+        if (available < max) {
+            m_consumer.cachedTail = m_producer.tail.load(std::memory_order_acquire);
+            available = static_cast<size_t>(m_consumer.cachedTail - head);
+        }
+        size_t n = max < available ? max : available;
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = m_slots[(head + i) & (N - 1)];
+        }
+        if (n != 0) {
+            m_consumer.head.store(head + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+    // Approximate when called concurrently with push/pop
+    size_t Size() const {
+        return static_cast<size_t>(m_producer.tail.load(std::memory_order_acquire)
+            - m_consumer.head.load(std::memory_order_acquire));
+    }
+
+private:
+    struct alignas(shmem_detail::kCacheLine) Producer {
+        std::atomic<uint64_t> tail{ 0 };
+        uint64_t cachedHead = 0;
+    };
+
+    struct alignas(shmem_detail::kCacheLine) Consumer {
+        std::atomic<uint64_t> head{ 0 };
+        uint64_t cachedTail = 0;
+    };
+
+    Producer m_producer;
+    Consumer m_consumer;
+    alignas(shmem_detail::kCacheLine) T m_slots[N];
+};
+
+// Multi-producer/multi-consumer ring (bounded queue with a sequence number
+// per cell). Producers and consumers claim positions with a CAS on their
+// own cache-line-padded counter; batches claim a run of ready cells at once.
+template<typename T, size_t N>
+class SharedRingBuffer<T, N, MpmcRing> {
+    static_assert(std::is_trivially_copyable_v<T>, "Ring elements must be trivially copyable");
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "Ring capacity must be a power of two");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Ring positions must be lock-free");
+
+public:
+    SharedRingBuffer() {
+        for (size_t i = 0; i < N; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    SharedRingBuffer(const SharedRingBuffer&) = delete;
+    SharedRingBuffer& operator=(const SharedRingBuffer&) = delete;
+
+    static constexpr size_t Capacity() { return N; }
+
+    bool TryPush(const T& item) {
+        return PushBatch(&item, 1) == 1;
+    }
+
+    bool TryPop(T& item) {
+        return PopBatch(&item, 1) == 1;
+    }
+
+    // Push up to count items, returns how many were claimed. A short count
+    // means the ring was (nearly) full when the claim was made.
+    size_t PushBatch(const T* items, size_t count) {
+        if (count == 0) {
+            return 0;  // The retry below would never claim anything
+        }
+        uint64_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            // A cell is free for position p when its sequence equals p
+            size_t n = 0;
+            while (n < count && n < N
+                && m_cells[(pos + n) & (N - 1)].sequence.load(std::memory_order_acquire) == pos + n) {
+                ++n;
+            }
+            if (n == 0) {
+                uint64_t seq = m_cells[pos & (N - 1)].sequence.load(std::memory_order_acquire);
+                if (static_cast<int64_t>(seq - pos) < 0) {
+                    return 0;  // Full
+                }
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed)) {
+                for (size_t i = 0; i < n; ++i) {
+                    Cell& cell = m_cells[(pos + i) & (N - 1)];
+                    cell.data = items[i];
+                    cell.sequence.store(pos + i + 1, std::memory_order_release);
+                }
+                return n;
+            }
+        }
+    }
+
+    // Pop up to max items into out, returns how many were claimed
+    size_t PopBatch(T* out, size_t max) {
+        if (max == 0) {
+            return 0;
+        }
+        uint64_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            // A cell holds the item for position p when its sequence is p + 1
+            size_t n = 0;
+            while (n < max && n < N
+                && m_cells[(pos + n) & (N - 1)].sequence.load(std::memory_order_acquire) == pos + n + 1) {
+                ++n;
+            }
+            if (n == 0) {
+                uint64_t seq = m_cells[pos & (N - 1)].sequence.load(std::memory_order_acquire);
+                if (static_cast<int64_t>(seq - (pos + 1)) < 0) {
+                    return 0;  // Empty
+                }
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (m_dequeuePos.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed)) {
+                for (size_t i = 0; i < n; ++i) {
+                    Cell& cell = m_cells[(pos + i) & (N - 1)];
+                    out[i] = cell.data;
+                    cell.sequence.store(pos + i + N, std::memory_order_release);
+                }
+                return n;
+            }
+        }
+    }
+
+    // Approximate when called concurrently with push/pop
+    size_t Size() const {
+        uint64_t enqueue = m_enqueuePos.load(std::memory_order_acquire);
+        uint64_t dequeue = m_dequeuePos.load(std::memory_order_acquire);
+        return enqueue > dequeue ? static_cast<size_t>(enqueue - dequeue) : 0;
+    }
+
+private:
+    struct Cell {
+        std::atomic<uint64_t> sequence;
+        T data;
+    };
+
+    alignas(shmem_detail::kCacheLine) std::atomic<uint64_t> m_enqueuePos{ 0 };
+    alignas(shmem_detail::kCacheLine) std::atomic<uint64_t> m_dequeuePos{ 0 };
+    alignas(shmem_detail::kCacheLine) Cell m_cells[N];
+};
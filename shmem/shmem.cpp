@@ -2,7 +2,19 @@
 //
 
 #include "shmem.h"
+#include "shared_ring_buffer.h"
+#include "shared_arena.h"
 #include <cstring>
+#include <cstdio>
+#include <chrono>
+#include <thread>
+
+#ifndef _WIN32
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char** environ;
+#endif
 
 struct SharedData {
     int counter;
@@ -10,6 +22,25 @@ struct SharedData {
     bool isReady;
 };
 
+// Streamed from the worker to the main process through a ring buffer
+struct Message {
+    uint64_t sequence;
+    uint64_t value;
+};
+
+constexpr uint64_t MESSAGE_COUNT = 10000000;
+constexpr size_t MESSAGE_BATCH = 256;
+using MessageRing = SharedRingBuffer<Message, 4096>;
+
+// Variable-sized log the worker appends to, allocated in a shared arena
+using LogArena = SharedArena<1024 * 1024>;
+
+struct WorkerLog {
+    explicit WorkerLog(const ArenaAllocator<ArenaString>& alloc) : lines(alloc) {}
+    ArenaVector<ArenaString> lines;
+};
+
+#ifdef _WIN32
 HANDLE createWorkerProcess(const char* command) {
     STARTUPINFOA si = { sizeof(si) };
     PROCESS_INFORMATION pi;
@@ -31,19 +62,32 @@ HANDLE createWorkerProcess(const char* command) {
     CloseHandle(pi.hThread);
     return pi.hProcess;
 }
+#else
+pid_t createWorkerProcess(const char* path) {
+    char* argv[] = { const_cast<char*>(path), nullptr };
+    pid_t pid;
+    int result = posix_spawn(&pid, path, nullptr, nullptr, argv, environ);
+    if (result != 0) {
+        throw std::system_error(result, std::generic_category(),
+            "Failed to create worker process");
+    }
+    return pid;
+}
+#endif
 
 int main()
 {
     try {
-        // Create shared memory (main process)
-        LocalSharedMemory<SharedData> shmem("Local\\MySharedMemory", true);
+        // Create shared memory (main process). SeqLock lets the polling
+        // Read() below run without taking the mutex the worker writes under.
+        LocalSharedMemory<SharedData, SeqLock> shmem("Local\\MySharedMemory", true);
         
         std::cout << "Shared memory created successfully!" << std::endl;
 
         // Initialize with Write()
         shmem.Write([](SharedData& data) {
             data.counter = 0;
-            strcpy_s(data.message, "Hello from main process!");
+            snprintf(data.message, sizeof(data.message), "Hello from main process!");
             data.isReady = true;
         });
 
@@ -53,16 +97,60 @@ int main()
             std::cout << "Message: " << data.message << std::endl;
         });
 
+        // Ring buffer the worker streams messages through
+        LocalSharedMemory<MessageRing> ring("Local\\MyMessageRing", true);
+
+        // Arena for the worker's log, found by other processes through its root
+        LocalSharedMemory<LogArena> arena("Local\\MyArena", true);
+        LogArena& logArena = arena.GetUnlocked();
+        WorkerLog* log = logArena.Construct<WorkerLog>(logArena.GetAllocator<ArenaString>());
+        logArena.SetRoot(log);
+
 		// Create worker process that will update shared memory
+#ifdef _WIN32
 		HANDLE hWorker = createWorkerProcess("worker.exe");
+#else
+		pid_t worker = createWorkerProcess("./worker");
+#endif
+
+		// Drain the message stream; the ring itself needs no locking
+		MessageRing& messages = ring.GetUnlocked();
+		Message batch[MESSAGE_BATCH];
+		uint64_t received = 0;
+		auto streamStart = std::chrono::steady_clock::now();
+		while (received < MESSAGE_COUNT) {
+			size_t count = messages.PopBatch(batch, MESSAGE_BATCH);
+			if (count == 0) {
+				std::this_thread::yield();
+				continue;
+			}
+			if (received == 0) {
+				streamStart = std::chrono::steady_clock::now();
+			}
+			for (size_t i = 0; i < count; ++i) {
+				if (batch[i].sequence != received + i) {
+					throw std::runtime_error("Message stream out of order");
+				}
+			}
+			received += count;
+		}
+		double seconds = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - streamStart).count();
+		std::cout << "Received " << received << " messages ("
+			<< static_cast<uint64_t>(received / seconds) << " msg/s)" << std::endl;
+
+		// Sleep until the worker process has bumped counter to 10
+		shmem.WaitUntil([](const SharedData& data) {
+			return data.counter >= 10;
+		});
+
+		// Appended under the same lock as the counter, so it's complete now
+		std::cout << "Worker log has " << log->lines.size() << " lines, last: \""
+			<< log->lines.back().c_str() << "\"" << std::endl;
 
-		// Loop until counter reaches 10 (updated by worker process)
-		int iter = 0;
-        while (iter < 10) {            
-            shmem.Read([&iter](const SharedData& data) {
-				iter = data.counter;
-            });
-        }
+#ifndef _WIN32
+        waitpid(worker, nullptr, 0);
+#endif
     }
     catch (const std::exception& ex) {
         std::cerr << "Error: " << ex.what() << std::endl;
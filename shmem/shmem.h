@@ -6,22 +6,421 @@
 #include <iostream>
 #include <string>
 #include <functional>
-#include <windows.h>
 #include <system_error>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <bit>
+#include <cerrno>
+#include <climits>
+#include <thread>
+#include <type_traits>
 
-// Thread/Process safe local shared memory class
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace shmem_detail {
+
+inline void CpuRelax() {
+#if defined(_MSC_VER)
+    YieldProcessor();
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+#ifdef _WIN32
+// Reader-writer lock for the Windows backend, which has no process-shared
+// rwlock object. The state word holds the reader count plus a writer bit.
+struct SpinRWLock {
+    static constexpr uint32_t kWriter = 0x80000000u;
+
+    std::atomic<uint32_t> state;
+    std::atomic<uint32_t> writersWaiting;
+
+    static void Backoff(uint32_t spins) {
+        if (spins < 64) {
+            CpuRelax();
+        } else {
+            SwitchToThread();
+        }
+    }
+
+    void LockShared(bool writerPreference) {
+        for (uint32_t spins = 0;; ++spins) {
+            uint32_t current = state.load(std::memory_order_relaxed);
+            bool writerPending = writerPreference
+                && writersWaiting.load(std::memory_order_relaxed) != 0;
+            if (!(current & kWriter) && !writerPending
+                && state.compare_exchange_weak(current, current + 1, std::memory_order_acquire)) {
+                return;
+            }
+            Backoff(spins);
+        }
+    }
+
+    bool TryLockShared(bool writerPreference) {
+        uint32_t current = state.load(std::memory_order_relaxed);
+        bool writerPending = writerPreference
+            && writersWaiting.load(std::memory_order_relaxed) != 0;
+        return !(current & kWriter) && !writerPending
+            && state.compare_exchange_strong(current, current + 1, std::memory_order_acquire);
+    }
+
+    void UnlockShared() {
+        state.fetch_sub(1, std::memory_order_release);
+    }
+
+    bool TryLock() {
+        uint32_t expected = 0;
+        return state.compare_exchange_strong(expected, kWriter, std::memory_order_acquire);
+    }
+
+    void Lock() {
+        writersWaiting.fetch_add(1, std::memory_order_relaxed);
+        for (uint32_t spins = 0;; ++spins) {
+            uint32_t expected = 0;
+            if (state.compare_exchange_weak(expected, kWriter, std::memory_order_acquire)) {
+                break;
+            }
+            Backoff(spins);
+        }
+        writersWaiting.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void Unlock() {
+        state.store(0, std::memory_order_release);
+    }
+};
+#endif
+
+inline uint64_t NowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+#ifdef _WIN32
+inline uint32_t CurrentPid() {
+    return static_cast<uint32_t>(GetCurrentProcessId());
+}
+#else
+// getpid() is a system call, too slow for every acquisition; the pid is
+// cached per process and cleared in the child after a fork
+inline std::atomic<uint32_t> cachedPid{0};
+
+inline void ForgetPid() {
+    cachedPid.store(0, std::memory_order_relaxed);
+}
+
+inline uint32_t CurrentPid() {
+    uint32_t pid = cachedPid.load(std::memory_order_relaxed);
+    if (pid == 0) {
+        static const bool registered = pthread_atfork(nullptr, nullptr, ForgetPid) == 0;
+        (void)registered;
+        pid = static_cast<uint32_t>(getpid());
+        cachedPid.store(pid, std::memory_order_relaxed);
+    }
+    return pid;
+}
+#endif
+
+// Lock counters kept in the segment header, so every process using the
+// segment contributes and shmem_stat can read them from outside. The block
+// is always there so the header layout doesn't depend on
+// SHMEM_ENABLE_STATS; only processes built with it update the counters,
+// and magic is set only when the creator was.
+struct LockStats {
+    static constexpr uint32_t kMagic = 0x54415453;  // "STAT"
+
+    // Log2 histograms: bucket 0 is 0 ns, bucket i counts [2^(i-1), 2^i) ns
+    static constexpr size_t kBuckets = 40;
+
+    uint32_t magic;
+    std::atomic<uint32_t> holderPid;         // Exclusive holder, 0 when free
+    std::atomic<uint64_t> acquisitions;      // Exclusive acquisitions
+    std::atomic<uint64_t> sharedAcquisitions;
+    std::atomic<uint64_t> contended;         // Either kind, try-acquire failed
+    std::atomic<uint64_t> acquiredAtNs;      // When the current holder got the lock
+    std::atomic<uint64_t> waitNs[kBuckets];  // Time to acquire, both kinds
+    std::atomic<uint64_t> holdNs[kBuckets];  // Exclusive hold time
+
+    static size_t Bucket(uint64_t ns) {
+        size_t bucket = static_cast<size_t>(std::bit_width(ns));
+        return bucket < kBuckets ? bucket : kBuckets - 1;
+    }
+
+    void Reset() {
+        holderPid.store(0, std::memory_order_relaxed);
+        acquisitions.store(0, std::memory_order_relaxed);
+        sharedAcquisitions.store(0, std::memory_order_relaxed);
+        contended.store(0, std::memory_order_relaxed);
+        acquiredAtNs.store(0, std::memory_order_relaxed);
+        for (size_t i = 0; i < kBuckets; ++i) {
+            waitNs[i].store(0, std::memory_order_relaxed);
+            holdNs[i].store(0, std::memory_order_relaxed);
+        }
+        magic = kMagic;
+    }
+
+    void OnAcquired(uint64_t wait, bool exclusive) {
+        (exclusive ? acquisitions : sharedAcquisitions).fetch_add(1, std::memory_order_relaxed);
+        if (wait != 0) {
+            contended.fetch_add(1, std::memory_order_relaxed);
+        }
+        waitNs[Bucket(wait)].fetch_add(1, std::memory_order_relaxed);
+        if (exclusive) {
+            holderPid.store(CurrentPid(), std::memory_order_relaxed);
+            acquiredAtNs.store(NowNs(), std::memory_order_relaxed);
+        }
+    }
+
+    // Called by the exclusive holder just before it unlocks
+    void OnReleased() {
+        uint64_t held = NowNs() - acquiredAtNs.load(std::memory_order_relaxed);
+        holdNs[Bucket(held)].fetch_add(1, std::memory_order_relaxed);
+        holderPid.store(0, std::memory_order_relaxed);
+    }
+};
+
+// Upper bound on the copies a MultiVersion segment can hold
+constexpr size_t kMaxVersions = 8;
+
+// Header at the start of every segment, followed by the payload
+struct SegmentHeader {
+#ifndef _WIN32
+    // The locks live inside the mapping, so an uncontended
+    // lock/unlock is a user-space futex operation
+    std::atomic<uint32_t> ready;
+    pthread_mutex_t mutex;
+    pthread_rwlock_t rwlock;
+#else
+    SpinRWLock rwlock;
+#endif
+    // Seqlock sequence, odd while a write is in progress. Kept on its own
+    // cache line so polling readers don't share a line with the mutex.
+    alignas(64) std::atomic<uint32_t> sequence;
+
+    // Change notification: bumped after every write and used as the futex
+    // word on Linux. Writers only issue a wake-up when someone is waiting.
+    alignas(64) std::atomic<uint32_t> version;
+    std::atomic<uint32_t> waiters;
+
+    // MultiVersion: index of the published copy, and how many readers
+    // currently hold each copy
+    alignas(64) std::atomic<uint32_t> published;
+    std::atomic<uint32_t> pins[kMaxVersions];
+
+    alignas(64) LockStats stats;  // Zero unless built with SHMEM_ENABLE_STATS
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+    "Shared memory atomics must be lock-free");
+
+#ifndef _WIN32
+// shm_open names must start with '/' and contain no other slashes,
+// e.g. "Local\\MySharedMemory" becomes "/Local_MySharedMemory"
+inline std::string PosixName(const std::string& name) {
+    std::string result = "/";
+    for (char c : name) {
+        result += (c == '\\' || c == '/') ? '_' : c;
+    }
+    return result;
+}
+
+// Where a huge-page segment lives instead: the same name on a hugetlbfs
+// mount. Such files are mapped in whole huge pages.
+inline std::string HugetlbfsPath(const std::string& directory, const std::string& name) {
+    return directory + PosixName(name);
+}
+#endif
+
+#ifdef __linux__
+// Shared (non-private) futex ops, so waiters in other processes are woken
+inline void FutexWait(std::atomic<uint32_t>* word, uint32_t expected, const timespec* timeout) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, timeout, nullptr, 0);
+}
+
+inline void FutexWakeAll(std::atomic<uint32_t>* word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+#endif
+
+template<typename Policy>
+struct SharedLockTraits {
+    static constexpr bool isShared = false;
+    static constexpr bool writerPreference = false;
+};
+
+template<typename Policy>
+struct MultiVersionTraits {
+    static constexpr size_t copies = 1;
+};
+
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+constexpr size_t RoundUp(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+#ifdef __linux__
+// Set a MPOL_BIND policy on a shared mapping; for shm this is the policy of
+// the segment itself, so pages faulted by any process land on the node.
+// Returns 0 or an errno value.
+inline int BindToNode(void* addr, size_t size, int node) {
+    constexpr int kMaxNodes = 1024;
+    constexpr int kBits = 8 * sizeof(unsigned long);
+    if (node < 0 || node >= kMaxNodes) {
+        return EINVAL;
+    }
+    unsigned long mask[kMaxNodes / kBits] = {};
+    mask[node / kBits] |= 1UL << (node % kBits);
+    if (syscall(SYS_mbind, addr, size, MPOL_BIND, mask, kMaxNodes, MPOL_MF_MOVE) != 0) {
+        return errno;
+    }
+    return 0;
+}
+#endif
+
+// Fault in every page of a mapping up front
+inline void Prefault(void* addr, size_t size) {
+#if defined(__linux__) && defined(MADV_POPULATE_WRITE)
+    if (madvise(addr, size, MADV_POPULATE_WRITE) == 0) {
+        return;
+    }
+#endif
+    // Older kernels / Windows: touch each page. Reads only, so data other
+    // processes have already written is left alone.
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    size_t pageSize = info.dwPageSize;
+#else
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    const volatile char* bytes = static_cast<const volatile char*>(addr);
+    for (size_t offset = 0; offset < size; offset += pageSize) {
+        (void)bytes[offset];
+    }
+}
+
+// Payload starts on its own cache line, after the header
 template<typename T>
+constexpr size_t PayloadOffset() {
+    constexpr size_t align = alignof(T) > 64 ? alignof(T) : 64;
+    return (sizeof(SegmentHeader) + align - 1) / align * align;
+}
+
+} // namespace shmem_detail
+
+// Lock policies for LocalSharedMemory
+
+// Read and Write both take the exclusive mutex
+struct ExclusiveLock {};
+
+// Writers take the mutex and bump a sequence counter; Read copies a
+// consistent snapshot without writing to shared memory, retrying on a
+// torn read. Requires a trivially copyable T.
+struct SeqLock {};
+
+// Read takes a shared lock so readers run concurrently; Write/WithLock take
+// it exclusively. With WriterPreference, waiting writers block new readers
+// so a steady stream of reads can't starve updates.
+// Unlike the mutex the other policies use, the lock is not robust: POSIX
+// has no robust rwlock, so a process that dies holding it, shared or
+// exclusive, blocks every later writer (and with WriterPreference every
+// reader too) until the segment is recreated.
+template<bool WriterPreference = true>
+struct SharedLock {};
+
+// The segment holds Copies instances of T. Write copies the published
+// instance into a free one, applies the update there and publishes it with
+// an atomic index flip. Read pins the published copy and runs on it in
+// place without taking any lock, so readers never wait for a writer; a
+// copy is only reused once no reader has it pinned. Writers still
+// serialize on the mutex. Requires a copy-assignable T.
+// A reader that dies inside Read never unpins its copy. A writer that
+// finds no unpinned copy within a second throws rather than wait forever.
+template<size_t Copies = 2>
+struct MultiVersion {};
+
+namespace shmem_detail {
+template<bool WriterPreference>
+struct SharedLockTraits<SharedLock<WriterPreference>> {
+    static constexpr bool isShared = true;
+    static constexpr bool writerPreference = WriterPreference;
+};
+
+template<size_t Copies>
+struct MultiVersionTraits<MultiVersion<Copies>> {
+    static_assert(Copies >= 2 && Copies <= kMaxVersions,
+        "MultiVersion supports 2 to kMaxVersions copies");
+    static constexpr size_t copies = Copies;
+};
+} // namespace shmem_detail
+
+// Creation options. The creator's options decide how the segment is backed;
+// openers only use prefault.
+struct SharedMemoryOptions {
+    // Back the segment with 2 MB pages (hugetlbfs on Linux, SEC_LARGE_PAGES
+    // on Windows), falling back to regular pages when none are available
+    bool hugePages = false;
+
+    // Bind the segment's memory to this NUMA node; -1 keeps the default policy
+    int numaNode = -1;
+
+    // Fault in every page at construction instead of on first access
+    bool prefault = false;
+
+    // hugetlbfs mount that huge-page segments are created in (Linux)
+    std::string hugetlbfsPath = "/dev/hugepages";
+};
+
+// Thread/Process safe local shared memory class
+template<typename T, typename LockPolicy = ExclusiveLock>
 class LocalSharedMemory {
+    static_assert(!std::is_same_v<LockPolicy, SeqLock> || std::is_trivially_copyable_v<T>,
+        "SeqLock requires a trivially copyable type");
+    static_assert(shmem_detail::MultiVersionTraits<LockPolicy>::copies == 1
+        || std::is_copy_assignable_v<T>, "MultiVersion requires a copy-assignable type");
+
 public:
     // Constructor for creating new shared memory (main process)
-    LocalSharedMemory(const std::string& name, bool create = true)
+    LocalSharedMemory(const std::string& name, bool create = true,
+                      const SharedMemoryOptions& options = SharedMemoryOptions())
         : m_name(name)
+#ifdef _WIN32
         , m_mutexName(name + "_Mutex")
         , m_hMapFile(nullptr)
         , m_hMutex(nullptr)
+        , m_hChanged(nullptr)
+        , m_largePages(false)
+#else
+        , m_shmName(shmem_detail::PosixName(name))
+        , m_mappedSize(0)
+#endif
+        , m_pHeader(nullptr)
         , m_pData(nullptr)
         , m_isOwner(create)
+        , m_seenVersion(0)
     {
+#ifdef _WIN32
         // Create or open mutex
         if (create) {
             m_hMutex = CreateMutexA(nullptr, FALSE, m_mutexName.c_str());
@@ -37,18 +436,53 @@ public:
             }
         }
 
+        // Create or open change-notification semaphore
+        std::string changedName = name + "_Changed";
+        if (create) {
+            m_hChanged = CreateSemaphoreA(nullptr, 0, LONG_MAX, changedName.c_str());
+        } else {
+            m_hChanged = OpenSemaphoreA(SYNCHRONIZE | SEMAPHORE_MODIFY_STATE, FALSE, changedName.c_str());
+        }
+        if (m_hChanged == nullptr) {
+            CloseHandle(m_hMutex);
+            throw std::system_error(GetLastError(), std::system_category(),
+                "Failed to open change notification");
+        }
+
         // Create or open shared memory
+        DWORD numaNode = options.numaNode >= 0 ? static_cast<DWORD>(options.numaNode)
+                                               : NUMA_NO_PREFERRED_NODE;
         if (create) {
-            m_hMapFile = CreateFileMappingA(
-                INVALID_HANDLE_VALUE,
-                nullptr,
-                PAGE_READWRITE,
-                0,
-                sizeof(T),
-                m_name.c_str()
-            );
+            // Large pages need SeLockMemoryPrivilege and a size rounded to
+            // the large page size; fall back to regular pages otherwise
+            SIZE_T largePage = options.hugePages ? GetLargePageMinimum() : 0;
+            if (largePage != 0) {
+                uint64_t size = shmem_detail::RoundUp(MappingSize(), largePage);
+                m_hMapFile = CreateFileMappingNumaA(
+                    INVALID_HANDLE_VALUE,
+                    nullptr,
+                    PAGE_READWRITE | SEC_COMMIT | SEC_LARGE_PAGES,
+                    static_cast<DWORD>(size >> 32),
+                    static_cast<DWORD>(size & 0xFFFFFFFFu),
+                    m_name.c_str(),
+                    numaNode
+                );
+                m_largePages = m_hMapFile != nullptr;
+            }
+            if (m_hMapFile == nullptr) {
+                m_hMapFile = CreateFileMappingNumaA(
+                    INVALID_HANDLE_VALUE,
+                    nullptr,
+                    PAGE_READWRITE,
+                    static_cast<DWORD>(static_cast<uint64_t>(MappingSize()) >> 32),
+                    static_cast<DWORD>(MappingSize() & 0xFFFFFFFFu),
+                    m_name.c_str(),
+                    numaNode
+                );
+            }
             
             if (m_hMapFile == nullptr) {
+                CloseHandle(m_hChanged);
                 CloseHandle(m_hMutex);
                 throw std::system_error(GetLastError(), std::system_category(), 
                     "Failed to create file mapping");
@@ -57,6 +491,7 @@ public:
             m_hMapFile = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, m_name.c_str());
             
             if (m_hMapFile == nullptr) {
+                CloseHandle(m_hChanged);
                 CloseHandle(m_hMutex);
                 throw std::system_error(GetLastError(), std::system_category(), 
                     "Failed to open file mapping");
@@ -64,23 +499,126 @@ public:
         }
 
         // Map view
-        m_pData = static_cast<T*>(
-            MapViewOfFile(m_hMapFile, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(T))
+        m_pHeader = static_cast<shmem_detail::SegmentHeader*>(
+            MapViewOfFileExNuma(m_hMapFile, FILE_MAP_ALL_ACCESS, 0, 0, MappingSize(),
+                                nullptr, numaNode)
         );
 
-        if (m_pData == nullptr) {
+        if (m_pHeader == nullptr) {
             CloseHandle(m_hMapFile);
+            CloseHandle(m_hChanged);
             CloseHandle(m_hMutex);
             throw std::system_error(GetLastError(), std::system_category(), 
                 "Failed to map view of file");
         }
 
+        if (options.prefault) {
+            shmem_detail::Prefault(m_pHeader, MappingSize());
+        }
+#else
+        // Create or open shared memory. Huge pages come from a file on a
+        // hugetlbfs mount; without one we fall back to regular shm.
+        void* base = nullptr;
+        if (create && options.hugePages) {
+            base = TryMapHugetlb(options.hugetlbfsPath, true);
+        }
+        if (base == nullptr) {
+            base = MapShm(create, options);
+        }
+
+#ifdef __linux__
+        if (create && options.numaNode >= 0) {
+            int error = shmem_detail::BindToNode(base, m_mappedSize, options.numaNode);
+            if (error != 0) {
+                munmap(base, m_mappedSize);
+                RemoveName();
+                throw std::system_error(error, std::generic_category(),
+                    "Failed to bind shared memory to NUMA node");
+            }
+        }
+#endif
+
+        if (options.prefault) {
+            shmem_detail::Prefault(base, m_mappedSize);
+        }
+
+        m_pHeader = static_cast<shmem_detail::SegmentHeader*>(base);
+
+        if (create) {
+            m_pHeader->ready.store(0, std::memory_order_relaxed);
+
+            // Process-shared so every mapping can use it, robust so a
+            // process dying while holding it can't wedge the segment
+            pthread_mutexattr_t attr;
+            pthread_mutexattr_init(&attr);
+            pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+            pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+            int result = pthread_mutex_init(&m_pHeader->mutex, &attr);
+            pthread_mutexattr_destroy(&attr);
+
+            if (result != 0) {
+                munmap(base, m_mappedSize);
+                RemoveName();
+                throw std::system_error(result, std::generic_category(),
+                    "Failed to create mutex");
+            }
+
+            // Process-shared but not robust; see SharedLock
+            pthread_rwlockattr_t rwAttr;
+            pthread_rwlockattr_init(&rwAttr);
+            pthread_rwlockattr_setpshared(&rwAttr, PTHREAD_PROCESS_SHARED);
+#ifdef __GLIBC__
+            pthread_rwlockattr_setkind_np(&rwAttr, kWriterPreference
+                ? PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP
+                : PTHREAD_RWLOCK_PREFER_READER_NP);
+#endif
+            result = pthread_rwlock_init(&m_pHeader->rwlock, &rwAttr);
+            pthread_rwlockattr_destroy(&rwAttr);
+
+            if (result != 0) {
+                munmap(base, m_mappedSize);
+                RemoveName();
+                throw std::system_error(result, std::generic_category(),
+                    "Failed to create reader-writer lock");
+            }
+        } else if (m_pHeader->ready.load(std::memory_order_acquire) == 0) {
+            munmap(base, m_mappedSize);
+            throw std::system_error(EAGAIN, std::generic_category(),
+                "Shared memory is not initialized");
+        }
+#endif
+
+        m_pData = reinterpret_cast<T*>(
+            reinterpret_cast<char*>(m_pHeader) + shmem_detail::PayloadOffset<T>());
+
         // Initialize memory if we're the creator
         if (create) {
+            m_pHeader->sequence.store(0, std::memory_order_relaxed);
+            m_pHeader->version.store(0, std::memory_order_relaxed);
+            m_pHeader->waiters.store(0, std::memory_order_relaxed);
+            m_pHeader->published.store(0, std::memory_order_relaxed);
+            for (auto& pins : m_pHeader->pins) {
+                pins.store(0, std::memory_order_relaxed);
+            }
+#ifdef SHMEM_ENABLE_STATS
+            m_pHeader->stats.Reset();
+#endif
+#ifdef _WIN32
+            m_pHeader->rwlock.state.store(0, std::memory_order_relaxed);
+            m_pHeader->rwlock.writersWaiting.store(0, std::memory_order_relaxed);
+#endif
             Lock();
-            new (m_pData) T();  // Placement new for proper initialization
+            for (size_t i = 0; i < kCopies; ++i) {
+                new (Copy(i)) T();  // Placement new for proper initialization
+            }
             Unlock();
+#ifndef _WIN32
+            m_pHeader->ready.store(1, std::memory_order_release);
+#endif
         }
+
+        // Changes made before this instance attached don't count as unseen
+        m_seenVersion = m_pHeader->version.load(std::memory_order_acquire);
     }
 
     // Destructor
@@ -89,17 +627,32 @@ public:
             // Destroy the object if we're the owner
             if (m_isOwner) {
                 Lock();
-                m_pData->~T();
+                for (size_t i = 0; i < kCopies; ++i) {
+                    Copy(i)->~T();
+                }
                 Unlock();
             }
-            UnmapViewOfFile(m_pData);
+#ifdef _WIN32
+            UnmapViewOfFile(m_pHeader);
+#else
+            munmap(m_pHeader, m_mappedSize);
+            if (m_isOwner) {
+                // Existing mappings stay valid; only the name goes away
+                RemoveName();
+            }
+#endif
         }
+#ifdef _WIN32
         if (m_hMapFile != nullptr) {
             CloseHandle(m_hMapFile);
         }
         if (m_hMutex != nullptr) {
             CloseHandle(m_hMutex);
         }
+        if (m_hChanged != nullptr) {
+            CloseHandle(m_hChanged);
+        }
+#endif
     }
 
     // Delete copy constructor and assignment operator
@@ -109,14 +662,28 @@ public:
     // Move constructor and assignment operator
     LocalSharedMemory(LocalSharedMemory&& other) noexcept
         : m_name(std::move(other.m_name))
+#ifdef _WIN32
         , m_mutexName(std::move(other.m_mutexName))
         , m_hMapFile(other.m_hMapFile)
         , m_hMutex(other.m_hMutex)
+        , m_hChanged(other.m_hChanged)
+        , m_largePages(other.m_largePages)
+#else
+        , m_shmName(std::move(other.m_shmName))
+        , m_hugetlbPath(std::move(other.m_hugetlbPath))
+        , m_mappedSize(other.m_mappedSize)
+#endif
+        , m_pHeader(other.m_pHeader)
         , m_pData(other.m_pData)
         , m_isOwner(other.m_isOwner)
+        , m_seenVersion(other.m_seenVersion)
     {
+#ifdef _WIN32
         other.m_hMapFile = nullptr;
         other.m_hMutex = nullptr;
+        other.m_hChanged = nullptr;
+#endif
+        other.m_pHeader = nullptr;
         other.m_pData = nullptr;
         other.m_isOwner = false;
     }
@@ -128,14 +695,28 @@ public:
             
             // Move resources
             m_name = std::move(other.m_name);
+#ifdef _WIN32
             m_mutexName = std::move(other.m_mutexName);
             m_hMapFile = other.m_hMapFile;
             m_hMutex = other.m_hMutex;
+            m_hChanged = other.m_hChanged;
+            m_largePages = other.m_largePages;
+#else
+            m_shmName = std::move(other.m_shmName);
+            m_hugetlbPath = std::move(other.m_hugetlbPath);
+            m_mappedSize = other.m_mappedSize;
+#endif
+            m_pHeader = other.m_pHeader;
             m_pData = other.m_pData;
             m_isOwner = other.m_isOwner;
+            m_seenVersion = other.m_seenVersion;
             
+#ifdef _WIN32
             other.m_hMapFile = nullptr;
             other.m_hMutex = nullptr;
+            other.m_hChanged = nullptr;
+#endif
+            other.m_pHeader = nullptr;
             other.m_pData = nullptr;
             other.m_isOwner = false;
         }
@@ -145,37 +726,59 @@ public:
     // Execute a function with exclusive access to shared memory
     template<typename Func>
     auto WithLock(Func&& func) -> decltype(func(std::declval<T&>())) {
+        if constexpr (kCopies > 1) {
+            return PublishNewVersion(std::forward<Func>(func));
+        }
         Lock();
+        BeginWrite();
         try {
             if constexpr (std::is_void_v<decltype(func(*m_pData))>) {
                 func(*m_pData);
+                EndWrite();
                 Unlock();
+                NotifyChanged();
             } else {
                 auto result = func(*m_pData);
+                EndWrite();
                 Unlock();
+                NotifyChanged();
                 return result;
             }
         } catch (...) {
+            EndWrite();
             Unlock();
+            NotifyChanged();
             throw;
         }
     }
 
-    // Read-only access with lock
+    // Read-only access with lock (shared under SharedLock). Under SeqLock, func runs on a private
+    // snapshot taken without the lock, so it must not keep references into it. Under MultiVersion
+    // it runs lock-free on the published copy, which stays valid until func returns.
     template<typename Func>
     auto Read(Func&& func) const -> decltype(func(std::declval<const T&>())) {
-        Lock();
+        m_seenVersion = m_pHeader->version.load(std::memory_order_acquire);
+        if constexpr (kCopies > 1) {
+            VersionPin pin(m_pHeader);
+            return func(static_cast<const T&>(*Copy(pin.index)));
+        }
+        if constexpr (std::is_same_v<LockPolicy, SeqLock>) {
+            alignas(T) unsigned char snapshot[sizeof(T)];
+            ReadSnapshot(snapshot);
+            return func(*std::launder(reinterpret_cast<const T*>(snapshot)));
+        }
+        LockShared();
         try {
             if constexpr (std::is_void_v<decltype(func(*m_pData))>) {
                 func(*m_pData);
-                Unlock();
+                UnlockShared();
             } else {
                 auto result = func(*m_pData);
-                Unlock();
+                UnlockShared();
                 return result;
             }
         } catch (...) {
-            Unlock();
+            UnlockShared();
             throw;
         }
     }
@@ -188,18 +791,133 @@ public:
 
     // Manual lock/unlock (use with caution - prefer WithLock/Read/Write)
     void Lock() const {
-        DWORD result = WaitForSingleObject(m_hMutex, INFINITE);
-        if (result != WAIT_OBJECT_0) {
-            throw std::system_error(GetLastError(), std::system_category(), 
-                "Failed to acquire mutex");
+#ifdef SHMEM_ENABLE_STATS
+        // Only a failed try-acquire is timed, so uncontended locks stay cheap
+        uint64_t waitNs = 0;
+        if (!AcquireExclusive(false)) {
+            uint64_t start = shmem_detail::NowNs();
+            AcquireExclusive(true);
+            waitNs = shmem_detail::NowNs() - start;
         }
+        m_pHeader->stats.OnAcquired(waitNs, true);
+#else
+        AcquireExclusive(true);
+#endif
     }
 
     void Unlock() const {
+#ifdef SHMEM_ENABLE_STATS
+        m_pHeader->stats.OnReleased();
+#endif
+        if constexpr (kSharedLock) {
+#ifdef _WIN32
+            m_pHeader->rwlock.Unlock();
+#else
+            int result = pthread_rwlock_unlock(&m_pHeader->rwlock);
+            if (result != 0) {
+                throw std::system_error(result, std::generic_category(),
+                    "Failed to release write lock");
+            }
+#endif
+            return;
+        }
+#ifdef _WIN32
         if (!ReleaseMutex(m_hMutex)) {
             throw std::system_error(GetLastError(), std::system_category(), 
                 "Failed to release mutex");
         }
+#else
+        int result = pthread_mutex_unlock(&m_pHeader->mutex);
+        if (result != 0) {
+            throw std::system_error(result, std::generic_category(),
+                "Failed to release mutex");
+        }
+#endif
+    }
+
+    // Shared lock for readers; same as Lock() unless the policy is SharedLock
+    void LockShared() const {
+        if constexpr (kSharedLock) {
+#ifdef SHMEM_ENABLE_STATS
+            uint64_t waitNs = 0;
+            if (!AcquireShared(false)) {
+                uint64_t start = shmem_detail::NowNs();
+                AcquireShared(true);
+                waitNs = shmem_detail::NowNs() - start;
+            }
+            m_pHeader->stats.OnAcquired(waitNs, false);
+#else
+            AcquireShared(true);
+#endif
+        } else {
+            Lock();
+        }
+    }
+
+    void UnlockShared() const {
+        if constexpr (kSharedLock) {
+#ifdef _WIN32
+            m_pHeader->rwlock.UnlockShared();
+#else
+            int result = pthread_rwlock_unlock(&m_pHeader->rwlock);
+            if (result != 0) {
+                throw std::system_error(result, std::generic_category(),
+                    "Failed to release read lock");
+            }
+#endif
+        } else {
+            Unlock();
+        }
+    }
+
+    // Direct access without any locking or change notification, for
+    // types that synchronize themselves (e.g. SharedRingBuffer). Under
+    // MultiVersion this is the currently published copy.
+    T& GetUnlocked() { return *Copy(PublishedIndex()); }
+    const T& GetUnlocked() const { return *Copy(PublishedIndex()); }
+
+    // Wake processes blocked in WaitForChange/WaitUntil. WithLock and Write
+    // do this automatically; call it after modifying data under Lock().
+    void NotifyChanged() {
+        m_pHeader->version.fetch_add(1, std::memory_order_seq_cst);
+        uint32_t waiters = m_pHeader->waiters.load(std::memory_order_seq_cst);
+        if (waiters == 0) {
+            return;
+        }
+#ifdef _WIN32
+        ReleaseSemaphore(m_hChanged, static_cast<LONG>(waiters), nullptr);
+#elif defined(__linux__)
+        shmem_detail::FutexWakeAll(&m_pHeader->version);
+#endif
+    }
+
+    // Block until a writer publishes a change this instance hasn't seen
+    // through Read/WaitForChange/WaitUntil. Returns false on timeout.
+    bool WaitForChange(std::chrono::milliseconds timeout = std::chrono::milliseconds::max()) {
+        bool changed = WaitForVersion(m_seenVersion, timeout);
+        m_seenVersion = m_pHeader->version.load(std::memory_order_acquire);
+        return changed;
+    }
+
+    // Block until pred(data) holds, re-evaluating it (via Read) only when a
+    // writer publishes a change. Returns false on timeout.
+    template<typename Pred>
+    bool WaitUntil(Pred&& pred, std::chrono::milliseconds timeout = std::chrono::milliseconds::max()) {
+        auto start = std::chrono::steady_clock::now();
+        for (;;) {
+            if (Read(pred)) {
+                return true;
+            }
+            auto remaining = timeout;
+            if (timeout != std::chrono::milliseconds::max()) {
+                remaining = timeout - std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start);
+                if (remaining <= std::chrono::milliseconds::zero()) {
+                    return false;
+                }
+            }
+            WaitForVersion(m_seenVersion, remaining);
+        }
     }
 
     // Check if this instance created the shared memory
@@ -208,11 +926,416 @@ public:
     // Get the name of the shared memory
     const std::string& GetName() const { return m_name; }
 
+    // Page size backing the segment. Huge pages are only reported when they
+    // were actually mapped; transparent huge page advice isn't counted, and
+    // on Windows only the creator knows whether it got large pages.
+    size_t GetPageSize() const {
+#ifdef _WIN32
+        if (m_largePages) {
+            return GetLargePageMinimum();
+        }
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+#else
+        return m_hugetlbPath.empty() ? static_cast<size_t>(sysconf(_SC_PAGESIZE))
+                                     : shmem_detail::kHugePageSize;
+#endif
+    }
+
+#ifdef SHMEM_ENABLE_STATS
+    // Lock counters shared by every process using the segment
+    const shmem_detail::LockStats& GetLockStats() const { return m_pHeader->stats; }
+#endif
+
 private:
+    static constexpr bool kSharedLock = shmem_detail::SharedLockTraits<LockPolicy>::isShared;
+    static constexpr bool kWriterPreference =
+        shmem_detail::SharedLockTraits<LockPolicy>::writerPreference;
+
+    // Seqlock readers spin this long on an odd sequence before waiting on
+    // the writer's mutex instead
+    static constexpr uint32_t kMaxReadSpins = 1024;
+
+    static constexpr size_t kCopies = shmem_detail::MultiVersionTraits<LockPolicy>::copies;
+
+    // MultiVersion writers give up on pinned copies after this long
+    static constexpr std::chrono::seconds kMaxPinWait{1};
+    static constexpr size_t kCopyStride = shmem_detail::RoundUp(sizeof(T),
+        alignof(T) > 64 ? alignof(T) : 64);
+
+    static constexpr size_t MappingSize() {
+        return shmem_detail::PayloadOffset<T>() + (kCopies - 1) * kCopyStride + sizeof(T);
+    }
+
+    T* Copy(size_t index) const {
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(m_pData) + index * kCopyStride);
+    }
+
+    size_t PublishedIndex() const {
+        return kCopies > 1 ? m_pHeader->published.load(std::memory_order_acquire) : 0;
+    }
+
+    // Holds a reader's pin on the published copy. The pin is re-validated
+    // after it is taken: a writer that picked this copy as free before the
+    // pin landed has not published it yet, so the reader retries instead.
+    struct VersionPin {
+        explicit VersionPin(shmem_detail::SegmentHeader* header) : header(header) {
+            for (;;) {
+                index = header->published.load(std::memory_order_seq_cst);
+                header->pins[index].fetch_add(1, std::memory_order_seq_cst);
+                if (header->published.load(std::memory_order_seq_cst) == index) {
+                    return;
+                }
+                header->pins[index].fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+        ~VersionPin() {
+            header->pins[index].fetch_sub(1, std::memory_order_release);
+        }
+        VersionPin(const VersionPin&) = delete;
+        VersionPin& operator=(const VersionPin&) = delete;
+
+        shmem_detail::SegmentHeader* header;
+        uint32_t index;
+    };
+
+    // Take the exclusive lock, or only try to when block is false.
+    // Returns whether the lock is held.
+    bool AcquireExclusive(bool block) const {
+        if constexpr (kSharedLock) {
+#ifdef _WIN32
+            if (!block) {
+                return m_pHeader->rwlock.TryLock();
+            }
+            m_pHeader->rwlock.Lock();
+#else
+            int result = block ? pthread_rwlock_wrlock(&m_pHeader->rwlock)
+                               : pthread_rwlock_trywrlock(&m_pHeader->rwlock);
+            if (result == EBUSY) {
+                return false;
+            }
+            if (result != 0) {
+                throw std::system_error(result, std::generic_category(),
+                    "Failed to acquire write lock");
+            }
+#endif
+            return true;
+        }
+#ifdef _WIN32
+        DWORD result = WaitForSingleObject(m_hMutex, block ? INFINITE : 0);
+        if (result == WAIT_TIMEOUT) {
+            return false;
+        }
+        if (result == WAIT_ABANDONED) {
+            // Owned now, but the previous holder died with it (see EOWNERDEAD)
+            EndAbandonedWrite();
+        } else if (result != WAIT_OBJECT_0) {
+            throw std::system_error(GetLastError(), std::system_category(), 
+                "Failed to acquire mutex");
+        }
+#else
+        int result = block ? pthread_mutex_lock(&m_pHeader->mutex)
+                           : pthread_mutex_trylock(&m_pHeader->mutex);
+        if (result == EBUSY) {
+            return false;
+        }
+        if (result == EOWNERDEAD) {
+            // The previous holder died with the lock held. Mark the mutex
+            // consistent so the segment stays usable; the data itself may
+            // reflect a partial update.
+            EndAbandonedWrite();
+            pthread_mutex_consistent(&m_pHeader->mutex);
+        } else if (result != 0) {
+            throw std::system_error(result, std::generic_category(),
+                "Failed to acquire mutex");
+        }
+#endif
+        return true;
+    }
+
+    // Shared counterpart of AcquireExclusive (SharedLock only)
+    bool AcquireShared(bool block) const {
+#ifdef _WIN32
+        if (!block) {
+            return m_pHeader->rwlock.TryLockShared(kWriterPreference);
+        }
+        m_pHeader->rwlock.LockShared(kWriterPreference);
+#else
+        int result = block ? pthread_rwlock_rdlock(&m_pHeader->rwlock)
+                           : pthread_rwlock_tryrdlock(&m_pHeader->rwlock);
+        if (result == EBUSY) {
+            return false;
+        }
+        if (result != 0) {
+            throw std::system_error(result, std::generic_category(),
+                "Failed to acquire read lock");
+        }
+#endif
+        return true;
+    }
+
+    // MultiVersion write: build the next version in a free copy and flip the
+    // published index. If func throws, nothing is published.
+    template<typename Func>
+    auto PublishNewVersion(Func&& func) -> decltype(func(std::declval<T&>())) {
+        Lock();
+        try {
+            uint32_t published = m_pHeader->published.load(std::memory_order_relaxed);
+            uint32_t next = AcquireFreeCopy(published);
+            T& draft = *Copy(next);
+            draft = *Copy(published);
+            if constexpr (std::is_void_v<decltype(func(draft))>) {
+                func(draft);
+                m_pHeader->published.store(next, std::memory_order_seq_cst);
+                Unlock();
+                NotifyChanged();
+            } else {
+                auto result = func(draft);
+                m_pHeader->published.store(next, std::memory_order_seq_cst);
+                Unlock();
+                NotifyChanged();
+                return result;
+            }
+        } catch (...) {
+            Unlock();
+            throw;
+        }
+    }
+
+    // A copy other than the published one with no reader pinned on it. With
+    // two copies this waits for readers of the previous version to finish;
+    // more copies let writers continue while slow readers hold older ones.
+    // Throws once kMaxPinWait passes, as pins of dead readers never clear.
+    uint32_t AcquireFreeCopy(uint32_t published) const {
+        std::chrono::steady_clock::time_point deadline;
+        for (uint32_t spins = 0;; ++spins) {
+            for (uint32_t i = 1; i < kCopies; ++i) {
+                uint32_t index = static_cast<uint32_t>((published + i) % kCopies);
+                if (m_pHeader->pins[index].load(std::memory_order_seq_cst) == 0) {
+                    return index;
+                }
+            }
+            if (spins < 64) {
+                shmem_detail::CpuRelax();
+                continue;
+            }
+            std::this_thread::yield();
+            auto now = std::chrono::steady_clock::now();
+            if (spins == 64) {
+                deadline = now + kMaxPinWait;
+            } else if (now >= deadline) {
+                throw std::system_error(ETIMEDOUT, std::generic_category(),
+                    "Timed out waiting for readers to release a copy");
+            }
+        }
+    }
+
+#ifndef _WIN32
+    // Map the regular shm segment, or when opening a name that only exists
+    // on hugetlbfs, that file instead
+    void* MapShm(bool create, const SharedMemoryOptions& options) {
+        int fd = shm_open(m_shmName.c_str(), create ? (O_CREAT | O_RDWR) : O_RDWR, 0600);
+        if (fd == -1) {
+            int error = errno;
+            if (!create && error == ENOENT) {
+                if (void* base = TryMapHugetlb(options.hugetlbfsPath, false)) {
+                    return base;
+                }
+            }
+            throw std::system_error(error, std::generic_category(),
+                create ? "Failed to create shared memory" : "Failed to open shared memory");
+        }
+
+        if (create) {
+            if (ftruncate(fd, static_cast<off_t>(MappingSize())) == -1) {
+                int error = errno;
+                close(fd);
+                shm_unlink(m_shmName.c_str());
+                throw std::system_error(error, std::generic_category(),
+                    "Failed to size shared memory");
+            }
+        } else {
+            struct stat st;
+            if (fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) < MappingSize()) {
+                close(fd);
+                throw std::system_error(EINVAL, std::generic_category(),
+                    "Shared memory segment is too small");
+            }
+        }
+
+        // Map view; the mapping keeps the segment alive after the fd is closed
+        void* base = mmap(nullptr, MappingSize(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        int mapError = errno;
+        close(fd);
+
+        if (base == MAP_FAILED) {
+            if (create) {
+                shm_unlink(m_shmName.c_str());
+            }
+            throw std::system_error(mapError, std::generic_category(),
+                "Failed to map shared memory");
+        }
+        m_mappedSize = MappingSize();
+
+#ifdef MADV_HUGEPAGE
+        if (create && options.hugePages) {
+            // Fallback: transparent huge pages, if shmem THP is enabled
+            madvise(base, m_mappedSize, MADV_HUGEPAGE);
+        }
+#endif
+        return base;
+    }
+
+    // Map the segment from a hugetlbfs file. Returns nullptr, having
+    // cleaned up, when there is no mount or no free huge pages.
+    void* TryMapHugetlb(const std::string& directory, bool create) {
+#ifdef MAP_HUGETLB
+        std::string path = shmem_detail::HugetlbfsPath(directory, m_name);
+        size_t size = shmem_detail::RoundUp(MappingSize(), shmem_detail::kHugePageSize);
+
+        int fd = open(path.c_str(), create ? (O_CREAT | O_RDWR) : O_RDWR, 0600);
+        if (fd == -1) {
+            return nullptr;
+        }
+        struct stat st;
+        bool sized = create ? ftruncate(fd, static_cast<off_t>(size)) == 0
+                            : fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= size;
+        void* base = MAP_FAILED;
+        if (sized) {
+            int hugeFlags = MAP_HUGETLB | (21 << MAP_HUGE_SHIFT);  // 2 MB pages
+            base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | hugeFlags, fd, 0);
+        }
+        close(fd);
+
+        if (base == MAP_FAILED) {
+            if (create) {
+                unlink(path.c_str());
+            }
+            return nullptr;
+        }
+        m_hugetlbPath = std::move(path);
+        m_mappedSize = size;
+        return base;
+#else
+        (void)directory;
+        (void)create;
+        return nullptr;
+#endif
+    }
+
+    void RemoveName() {
+        if (m_hugetlbPath.empty()) {
+            shm_unlink(m_shmName.c_str());
+        } else {
+            unlink(m_hugetlbPath.c_str());
+        }
+    }
+#endif
+
+    // Seqlock write section: the sequence is odd while the payload is
+    // being modified. No-ops for the other policies.
+    void BeginWrite() {
+        if constexpr (std::is_same_v<LockPolicy, SeqLock>) {
+            m_pHeader->sequence.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+    }
+
+    void EndWrite() {
+        if constexpr (std::is_same_v<LockPolicy, SeqLock>) {
+            m_pHeader->sequence.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    // Called with the lock held after its owner died. A writer that died
+    // between BeginWrite and EndWrite left the sequence odd; end its write
+    // so readers stop waiting for it.
+    void EndAbandonedWrite() const {
+        if constexpr (std::is_same_v<LockPolicy, SeqLock>) {
+            uint32_t sequence = m_pHeader->sequence.load(std::memory_order_relaxed);
+            if (sequence & 1) {
+                m_pHeader->sequence.store(sequence + 1, std::memory_order_release);
+            }
+        }
+    }
+
+    // Sleep until the version moves past `seen`
+    bool WaitForVersion(uint32_t seen, std::chrono::milliseconds timeout) const {
+        const bool infinite = timeout == std::chrono::milliseconds::max();
+        const auto deadline = infinite ? std::chrono::steady_clock::time_point::max()
+                                       : std::chrono::steady_clock::now() + timeout;
+        for (;;) {
+            if (m_pHeader->version.load(std::memory_order_acquire) != seen) {
+                return true;
+            }
+            auto remaining = deadline - std::chrono::steady_clock::now();
+            if (!infinite && remaining <= std::chrono::steady_clock::duration::zero()) {
+                return false;
+            }
+
+            // Register before re-checking, so a writer either sees us
+            // waiting or we see its new version
+            m_pHeader->waiters.fetch_add(1, std::memory_order_seq_cst);
+#ifdef _WIN32
+            if (m_pHeader->version.load(std::memory_order_seq_cst) == seen) {
+                DWORD ms = infinite ? INFINITE : static_cast<DWORD>(
+                    std::chrono::duration_cast<std::chrono::milliseconds>(remaining).count() + 1);
+                WaitForSingleObject(m_hChanged, ms);
+            }
+#elif defined(__linux__)
+            if (infinite) {
+                shmem_detail::FutexWait(&m_pHeader->version, seen, nullptr);
+            } else {
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(remaining).count();
+                timespec ts{ static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000) };
+                shmem_detail::FutexWait(&m_pHeader->version, seen, &ts);
+            }
+#else
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+            m_pHeader->waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Copy the payload, retrying until no write overlapped the copy
+    void ReadSnapshot(unsigned char* snapshot) const {
+        for (uint32_t spins = 0;; ++spins) {
+            uint32_t begin = m_pHeader->sequence.load(std::memory_order_acquire);
+            if (begin & 1) {
+                if (spins < kMaxReadSpins) {
+                    shmem_detail::CpuRelax();
+                    continue;
+                }
+                // The writer was preempted or died mid-write. Lock returns
+                // once a live one finishes, and ends a dead one's write.
+                Lock();
+                Unlock();
+                spins = 0;
+                continue;
+            }
+            std::memcpy(snapshot, m_pData, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_pHeader->sequence.load(std::memory_order_relaxed) == begin) {
+                return;
+            }
+        }
+    }
+
     std::string m_name;
+#ifdef _WIN32
     std::string m_mutexName;
     HANDLE m_hMapFile;
     HANDLE m_hMutex;
+    HANDLE m_hChanged;
+    bool m_largePages;  // Created with SEC_LARGE_PAGES
+#else
+    std::string m_shmName;
+    std::string m_hugetlbPath;  // Set when the segment lives on hugetlbfs
+    size_t m_mappedSize;
+#endif
+    shmem_detail::SegmentHeader* m_pHeader;
     T* m_pData;
     bool m_isOwner;
+    mutable uint32_t m_seenVersion;  // Last version observed by this instance
 };
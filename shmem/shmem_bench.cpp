@@ -0,0 +1,249 @@
+// shmem_bench.cpp : Google Benchmark suite for LocalSharedMemory
+//
+//  - uncontended Read/Write latency per lock policy
+//  - contended Write and Read throughput with 1..16 processes
+//  - cross-process ping-pong round trip (p50/p99/p999)
+//
+// Linux only (forks helper processes).
+//
+
+#include "shmem.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <sys/wait.h>
+
+// Trivially copyable so every policy, SeqLock included, can hold it
+struct Payload {
+    uint64_t values[8];
+};
+
+constexpr const char* SEGMENT_NAME = "Local\\ShmemBench";
+
+// Start/stop flags and results shared with forked helpers. Lives in an
+// anonymous shared mapping so it stays out of the segment being measured.
+struct Control {
+    std::atomic<uint32_t> ready{ 0 };
+    std::atomic<bool> go{ false };
+    std::atomic<bool> stop{ false };
+    std::atomic<uint64_t> operations{ 0 };
+};
+
+class SharedControl {
+public:
+    SharedControl() {
+        void* memory = mmap(nullptr, sizeof(Control), PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "Failed to map control block");
+        }
+        m_control = new (memory) Control();
+    }
+    ~SharedControl() { munmap(m_control, sizeof(Control)); }
+    SharedControl(const SharedControl&) = delete;
+    SharedControl& operator=(const SharedControl&) = delete;
+
+    Control* operator->() const { return m_control; }
+
+private:
+    Control* m_control;
+};
+
+// Fork a helper that runs body() and exits without unwinding the parent's state
+template<typename Body>
+pid_t spawnHelper(Body&& body) {
+    pid_t pid = fork();
+    if (pid == -1) {
+        throw std::system_error(errno, std::generic_category(), "Failed to fork helper");
+    }
+    if (pid == 0) {
+        int status = 0;
+        try {
+            body();
+        } catch (const std::exception& ex) {
+            std::fprintf(stderr, "Helper error: %s\n", ex.what());
+            status = 1;
+        }
+        _exit(status);
+    }
+    return pid;
+}
+
+void waitHelpers(const std::vector<pid_t>& helpers) {
+    for (pid_t pid : helpers) {
+        waitpid(pid, nullptr, 0);
+    }
+}
+
+uint64_t sumValues(const Payload& data) {
+    uint64_t sum = 0;
+    for (uint64_t value : data.values) {
+        sum += value;
+    }
+    return sum;
+}
+
+void incrementValues(Payload& data) {
+    for (uint64_t& value : data.values) {
+        ++value;
+    }
+}
+
+// Uncontended latency
+
+template<typename Policy>
+void BM_Read(benchmark::State& state) {
+    LocalSharedMemory<Payload, Policy> shmem(SEGMENT_NAME, true);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(shmem.Read(sumValues));
+    }
+}
+
+template<typename Policy>
+void BM_Write(benchmark::State& state) {
+    LocalSharedMemory<Payload, Policy> shmem(SEGMENT_NAME, true);
+    for (auto _ : state) {
+        shmem.Write(incrementValues);
+    }
+}
+
+// Contended throughput: the benchmark process plus range(0) - 1 helpers
+// all run the same operation; the "ops" counter is the combined rate
+
+template<typename Policy, bool Writes>
+void BM_Contended(benchmark::State& state) {
+    LocalSharedMemory<Payload, Policy> shmem(SEGMENT_NAME, true);
+    SharedControl control;
+    const int helperCount = static_cast<int>(state.range(0)) - 1;
+
+    std::vector<pid_t> helpers;
+    for (int i = 0; i < helperCount; ++i) {
+        helpers.push_back(spawnHelper([&] {
+            LocalSharedMemory<Payload, Policy> helper(SEGMENT_NAME, false);
+            control->ready.fetch_add(1);
+            // Only operations inside the timed window count
+            while (!control->go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            uint64_t operations = 0;
+            while (!control->stop.load(std::memory_order_relaxed)) {
+                if constexpr (Writes) {
+                    helper.Write(incrementValues);
+                } else {
+                    benchmark::DoNotOptimize(helper.Read(sumValues));
+                }
+                ++operations;
+            }
+            control->operations.fetch_add(operations);
+        }));
+    }
+    while (control->ready.load() != static_cast<uint32_t>(helperCount)) {
+        std::this_thread::yield();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    control->go.store(true, std::memory_order_release);
+    for (auto _ : state) {
+        if constexpr (Writes) {
+            shmem.Write(incrementValues);
+        } else {
+            benchmark::DoNotOptimize(shmem.Read(sumValues));
+        }
+    }
+    control->stop.store(true);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    waitHelpers(helpers);
+
+    double total = static_cast<double>(state.iterations() + control->operations.load());
+    state.counters["ops"] = benchmark::Counter(total / seconds);
+}
+
+// Ping-pong: the benchmark process bumps the value, a helper answers with
+// the next one. With Sleep the waiting side blocks in WaitUntil (futex);
+// otherwise both sides poll Read.
+
+template<typename Policy, bool Sleep>
+void BM_PingPong(benchmark::State& state) {
+    LocalSharedMemory<Payload, Policy> shmem(SEGMENT_NAME, true);
+    SharedControl control;
+
+    auto waitFor = [](LocalSharedMemory<Payload, Policy>& segment, uint64_t expected) {
+        auto arrived = [expected](const Payload& data) { return data.values[0] >= expected; };
+        if constexpr (Sleep) {
+            segment.WaitUntil(arrived);
+        } else {
+            // Yield after a while so an oversubscribed machine still makes progress
+            for (uint32_t spins = 0; !segment.Read(arrived); ++spins) {
+                if (spins < 1024) {
+                    shmem_detail::CpuRelax();
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    };
+
+    pid_t helper = spawnHelper([&] {
+        LocalSharedMemory<Payload, Policy> peer(SEGMENT_NAME, false);
+        control->ready.store(1);
+        // Odd values are pings, even ones pongs; ~0 ends the run
+        for (uint64_t next = 1;; next += 2) {
+            waitFor(peer, next);
+            if (peer.Read([](const Payload& data) { return data.values[0]; }) == ~uint64_t(0)) {
+                return;
+            }
+            peer.Write([next](Payload& data) { data.values[0] = next + 1; });
+        }
+    });
+    while (control->ready.load() == 0) {
+        std::this_thread::yield();
+    }
+
+    std::vector<double> roundTrips;
+    roundTrips.reserve(1 << 20);
+    uint64_t ping = 1;
+    for (auto _ : state) {
+        auto start = std::chrono::steady_clock::now();
+        shmem.Write([ping](Payload& data) { data.values[0] = ping; });
+        waitFor(shmem, ping + 1);
+        roundTrips.push_back(std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count());
+        ping += 2;
+    }
+    shmem.Write([](Payload& data) { data.values[0] = ~uint64_t(0); });
+    waitHelpers({ helper });
+
+    std::sort(roundTrips.begin(), roundTrips.end());
+    auto percentile = [&](double fraction) {
+        return roundTrips.empty() ? 0.0
+            : roundTrips[static_cast<size_t>(fraction * (roundTrips.size() - 1))];
+    };
+    state.counters["p50_ns"] = percentile(0.50);
+    state.counters["p99_ns"] = percentile(0.99);
+    state.counters["p999_ns"] = percentile(0.999);
+}
+
+BENCHMARK_TEMPLATE(BM_Read, ExclusiveLock);
+BENCHMARK_TEMPLATE(BM_Read, SeqLock);
+BENCHMARK_TEMPLATE(BM_Read, SharedLock<true>);
+BENCHMARK_TEMPLATE(BM_Read, MultiVersion<2>);
+
+BENCHMARK_TEMPLATE(BM_Write, ExclusiveLock);
+BENCHMARK_TEMPLATE(BM_Write, SeqLock);
+BENCHMARK_TEMPLATE(BM_Write, SharedLock<true>);
+BENCHMARK_TEMPLATE(BM_Write, MultiVersion<2>);
+
+BENCHMARK_TEMPLATE(BM_Contended, ExclusiveLock, true)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Contended, SeqLock, true)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Contended, ExclusiveLock, false)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Contended, SeqLock, false)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Contended, SharedLock<true>, false)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Contended, MultiVersion<2>, false)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+
+BENCHMARK_TEMPLATE(BM_PingPong, ExclusiveLock, false)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PingPong, SeqLock, false)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PingPong, SeqLock, true)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,178 @@
+// shmem_stat.cpp : Print live lock statistics of a named shared memory
+// segment. The processes using it must be built with SHMEM_ENABLE_STATS.
+//
+// Usage: shmem_stat <name> [interval ms] [count]
+//
+
+#include "shmem.h"
+#include <cstdio>
+#include <cstdlib>
+
+using shmem_detail::LockStats;
+
+struct Snapshot {
+    uint64_t acquisitions;
+    uint64_t sharedAcquisitions;
+    uint64_t contended;
+    uint64_t waitNs[LockStats::kBuckets];
+    uint64_t holdNs[LockStats::kBuckets];
+};
+
+Snapshot takeSnapshot(const LockStats& stats) {
+    Snapshot snapshot;
+    snapshot.acquisitions = stats.acquisitions.load(std::memory_order_relaxed);
+    snapshot.sharedAcquisitions = stats.sharedAcquisitions.load(std::memory_order_relaxed);
+    snapshot.contended = stats.contended.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < LockStats::kBuckets; ++i) {
+        snapshot.waitNs[i] = stats.waitNs[i].load(std::memory_order_relaxed);
+        snapshot.holdNs[i] = stats.holdNs[i].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+// Upper bound of the histogram bucket holding the given percentile
+uint64_t percentile(const uint64_t* buckets, const uint64_t* previous, double fraction) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < LockStats::kBuckets; ++i) {
+        total += buckets[i] - previous[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>(fraction * total);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LockStats::kBuckets; ++i) {
+        seen += buckets[i] - previous[i];
+        if (seen > target) {
+            return i == 0 ? 0 : (uint64_t(1) << i);
+        }
+    }
+    return uint64_t(1) << (LockStats::kBuckets - 1);
+}
+
+// Maps the segment header read-only, without knowing the payload type
+class HeaderView {
+public:
+    explicit HeaderView(const std::string& name) {
+#ifdef _WIN32
+        m_hMapFile = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+        if (m_hMapFile == nullptr) {
+            throw std::system_error(GetLastError(), std::system_category(),
+                "Failed to open shared memory");
+        }
+        void* view = MapViewOfFile(m_hMapFile, FILE_MAP_READ, 0, 0, sizeof(shmem_detail::SegmentHeader));
+        if (view == nullptr) {
+            DWORD error = GetLastError();
+            CloseHandle(m_hMapFile);
+            throw std::system_error(error, std::system_category(), "Failed to map shared memory");
+        }
+#else
+        // Same lookup as LocalSharedMemory: shm first, then hugetlbfs
+        int fd = shm_open(shmem_detail::PosixName(name).c_str(), O_RDONLY, 0);
+        if (fd == -1 && errno == ENOENT) {
+            std::string path = shmem_detail::HugetlbfsPath(SharedMemoryOptions().hugetlbfsPath, name);
+            fd = open(path.c_str(), O_RDONLY);
+            if (fd != -1) {
+                m_mappedSize = shmem_detail::kHugePageSize;
+            } else {
+                errno = ENOENT;
+            }
+        }
+        if (fd == -1) {
+            throw std::system_error(errno, std::generic_category(), "Failed to open shared memory");
+        }
+        struct stat st;
+        if (fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) < m_mappedSize) {
+            close(fd);
+            throw std::system_error(EINVAL, std::generic_category(), "Segment is too small");
+        }
+        void* view = mmap(nullptr, m_mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+        int error = errno;
+        close(fd);
+        if (view == MAP_FAILED) {
+            throw std::system_error(error, std::generic_category(), "Failed to map shared memory");
+        }
+#endif
+        m_pHeader = static_cast<const shmem_detail::SegmentHeader*>(view);
+        if (m_pHeader->stats.magic != LockStats::kMagic) {
+            Release();
+            throw std::runtime_error("Segment was not created with SHMEM_ENABLE_STATS");
+        }
+    }
+
+    ~HeaderView() { Release(); }
+
+    HeaderView(const HeaderView&) = delete;
+    HeaderView& operator=(const HeaderView&) = delete;
+
+    const LockStats& Stats() const { return m_pHeader->stats; }
+
+private:
+    void Release() {
+        if (m_pHeader == nullptr) {
+            return;
+        }
+#ifdef _WIN32
+        UnmapViewOfFile(m_pHeader);
+        CloseHandle(m_hMapFile);
+#else
+        munmap(const_cast<shmem_detail::SegmentHeader*>(m_pHeader), m_mappedSize);
+#endif
+        m_pHeader = nullptr;
+    }
+
+#ifdef _WIN32
+    HANDLE m_hMapFile = nullptr;
+#else
+    size_t m_mappedSize = sizeof(shmem_detail::SegmentHeader);  // Whole huge page on hugetlbfs
+#endif
+    const shmem_detail::SegmentHeader* m_pHeader = nullptr;
+};
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: %s <name> [interval ms] [count]\n", argv[0]);
+        return 2;
+    }
+    int intervalMs = argc > 2 ? std::atoi(argv[2]) : 1000;
+    int count = argc > 3 ? std::atoi(argv[3]) : 0;
+    if (intervalMs < 1) {
+        intervalMs = 1000;
+    }
+
+    try {
+        HeaderView view(argv[1]);
+        const LockStats& stats = view.Stats();
+
+        std::printf("%10s %10s %8s %10s %10s %10s %10s %8s\n", "excl/s", "shared/s", "cont%",
+            "wait p50", "wait p99", "hold p50", "hold p99", "holder");
+        Snapshot previous = takeSnapshot(stats);
+        for (int i = 0; count == 0 || i < count; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+            Snapshot current = takeSnapshot(stats);
+
+            double seconds = intervalMs / 1000.0;
+            uint64_t exclusive = current.acquisitions - previous.acquisitions;
+            uint64_t shared = current.sharedAcquisitions - previous.sharedAcquisitions;
+            uint64_t contended = current.contended - previous.contended;
+            uint64_t total = exclusive + shared;
+            std::printf("%10.0f %10.0f %7.2f%% %8lluns %8lluns %8lluns %8lluns %8u\n",
+                exclusive / seconds, shared / seconds,
+                total != 0 ? 100.0 * contended / total : 0.0,
+                static_cast<unsigned long long>(percentile(current.waitNs, previous.waitNs, 0.50)),
+                static_cast<unsigned long long>(percentile(current.waitNs, previous.waitNs, 0.99)),
+                static_cast<unsigned long long>(percentile(current.holdNs, previous.holdNs, 0.50)),
+                static_cast<unsigned long long>(percentile(current.holdNs, previous.holdNs, 0.99)),
+                stats.holderPid.load(std::memory_order_relaxed));
+            std::fflush(stdout);
+            previous = current;
+        }
+    }
+    catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
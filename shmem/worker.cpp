@@ -2,7 +2,10 @@
 //
 
 #include "shmem.h"
+#include "shared_ring_buffer.h"
+#include "shared_arena.h"
 #include <cstring>
+#include <cstdio>
 #include <thread>
 #include <chrono>
 
@@ -12,19 +15,62 @@ struct SharedData {
     bool isReady;
 };
 
+// Streamed from the worker to the main process through a ring buffer
+struct Message {
+    uint64_t sequence;
+    uint64_t value;
+};
+
+constexpr uint64_t MESSAGE_COUNT = 10000000;
+constexpr size_t MESSAGE_BATCH = 256;
+using MessageRing = SharedRingBuffer<Message, 4096>;
+
+// Variable-sized log the worker appends to, allocated in a shared arena
+using LogArena = SharedArena<1024 * 1024>;
+
+struct WorkerLog {
+    explicit WorkerLog(const ArenaAllocator<ArenaString>& alloc) : lines(alloc) {}
+    ArenaVector<ArenaString> lines;
+};
+
 int main()
 {
     try {
         // Open existing shared memory (worker process)
-        LocalSharedMemory<SharedData> shmem("Local\\MySharedMemory", false);
+        LocalSharedMemory<SharedData, SeqLock> shmem("Local\\MySharedMemory", false);
         
+        LocalSharedMemory<MessageRing> ring("Local\\MyMessageRing", false);
+        LocalSharedMemory<LogArena> arena("Local\\MyArena", false);
+        WorkerLog* log = arena.GetUnlocked().GetRoot<WorkerLog>();
+
         std::cout << "Connected to shared memory!" << std::endl;
 
+        // Stream messages to the main process in batches
+        MessageRing& messages = ring.GetUnlocked();
+        Message batch[MESSAGE_BATCH];
+        for (uint64_t next = 0; next < MESSAGE_COUNT;) {
+            size_t count = 0;
+            while (count < MESSAGE_BATCH && next + count < MESSAGE_COUNT) {
+                batch[count] = { next + count, (next + count) * 2 };
+                ++count;
+            }
+            size_t pushed = 0;
+            while (pushed < count) {
+                size_t n = messages.PushBatch(batch + pushed, count - pushed);
+                if (n == 0) {
+                    std::this_thread::yield();
+                }
+                pushed += n;
+            }
+            next += count;
+        }
+
         for (int i = 1; i <= 10; ++i) {
-            shmem.Write([i](SharedData& data) {
+            shmem.Write([i, log](SharedData& data) {
                 data.counter++;
-                sprintf_s(data.message, "Worker update #%d at counter %d", 
+                snprintf(data.message, sizeof(data.message), "Worker update #%d at counter %d", 
                          i, data.counter);
+                log->lines.emplace_back(data.message, log->lines.get_allocator());
                 std::cout << "Wrote: Counter=" << data.counter 
                          << ", Message=\"" << data.message << "\"" << std::endl;
             });
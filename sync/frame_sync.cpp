@@ -0,0 +1,562 @@
+// frame_sync.cpp : Windows and Linux backends of frame_sync.h
+//
+
+#include "frame_sync.h"
+
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#elif defined(__linux__)
+#include <climits>
+#include <csignal>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+extern char** environ;
+#else
+#error "frame_sync has no backend for this platform"
+#endif
+
+using namespace std;
+
+constexpr uint32_t SEGMENT_MAGIC = 0x53594e43;	// "SYNC", written last by the creator
+
+struct FrameSync::Segment
+{
+	atomic<uint32_t> magic;
+	uint32_t renderers;
+	FutexSemaphoreWord frameDone;
+	FrameSlot frames[MAX_FRAMES_IN_FLIGHT];
+	RendererSlot slots[MAX_RENDERERS];
+};
+
+namespace
+{
+	class SpinLock
+	{
+	public:
+		// Gives up at deadlineNs, if given; check locked()
+		SpinLock(atomic<uint32_t>& word, int taker, int64_t deadlineNs = 0) : m_word(word)
+		{
+			uint32_t free = 0;
+			while (!m_word.compare_exchange_weak(free, static_cast<uint32_t>(taker) + 1, memory_order_acquire, memory_order_relaxed))
+			{
+				while (m_word.load(memory_order_relaxed) != 0)
+				{
+					if (deadlineNs != 0 && nowNs() >= deadlineNs)
+					{
+						return;
+					}
+					this_thread::yield();
+				}
+				free = 0;
+			}
+			m_locked = true;
+		}
+
+		~SpinLock()
+		{
+			if (m_locked)
+			{
+				m_word.store(0, memory_order_release);
+			}
+		}
+
+		bool locked() const { return m_locked; }
+
+	private:
+		atomic<uint32_t>& m_word;
+		bool m_locked = false;
+	};
+
+	int64_t deadlineAfter(int timeoutMs)
+	{
+		return timeoutMs < 0 ? 0 : nowNs() + timeoutMs * int64_t(1000000);
+	}
+}
+
+bool TileQueue::push(TileRef tile, int taker, int timeoutMs)
+{
+	SpinLock guard(lock, taker, deadlineAfter(timeoutMs));
+	if (!guard.locked() || tail - head == TILE_QUEUE_CAPACITY)
+	{
+		return false;
+	}
+	items[tail % TILE_QUEUE_CAPACITY] = tile;
+	++tail;
+	return true;
+}
+
+bool TileQueue::pop(TileRef& tile, int taker, atomic<int64_t>& claim)
+{
+	SpinLock guard(lock, taker);
+	if (head == tail)
+	{
+		return false;
+	}
+	tile = items[head % TILE_QUEUE_CAPACITY];
+	claim.store(tile.id(), memory_order_relaxed);
+	++head;
+	return true;
+}
+
+bool TileQueue::queued(int32_t frame, int taker, int timeoutMs, uint64_t& tiles)
+{
+	SpinLock guard(lock, taker, deadlineAfter(timeoutMs));
+	if (!guard.locked())
+	{
+		return false;
+	}
+	for (uint32_t at = head; at != tail; ++at)
+	{
+		if (items[at % TILE_QUEUE_CAPACITY].frame == frame)
+		{
+			tiles |= uint64_t(1) << items[at % TILE_QUEUE_CAPACITY].tile;
+		}
+	}
+	return true;
+}
+
+void TileQueue::breakLock(int taker)
+{
+	uint32_t held = static_cast<uint32_t>(taker) + 1;
+	lock.compare_exchange_strong(held, 0, memory_order_release);
+}
+
+RendererSlot& FrameSync::slot(int renderer)
+{
+	return m_segment->slots[renderer];
+}
+
+FrameSlot& FrameSync::frame(int frameSlot)
+{
+	return m_segment->frames[frameSlot];
+}
+
+unique_ptr<FrameSync> FrameSync::create(int renderers, string& error)
+{
+	if (renderers < 1 || renderers > MAX_RENDERERS)
+	{
+		error = "renderer count must be 1 to " + to_string(MAX_RENDERERS);
+		return nullptr;
+	}
+	unique_ptr<FrameSync> sync(new FrameSync());
+	if (!sync->map(true, renderers, error))
+	{
+		return nullptr;
+	}
+	return sync;
+}
+
+unique_ptr<FrameSync> FrameSync::open(string& error)
+{
+	unique_ptr<FrameSync> sync(new FrameSync());
+	if (!sync->map(false, 0, error))
+	{
+		return nullptr;
+	}
+	return sync;
+}
+
+#ifdef _WIN32
+
+namespace
+{
+	const wchar_t* SEGMENT_NAME = L"Global\\SyncFrames";
+
+	string lastError(const char* step)
+	{
+		return string(step) + " failed. Error: " + to_string(GetLastError());
+	}
+}
+
+void SyncSemaphore::post()
+{
+	ReleaseSemaphore(m_handle, 1, NULL);
+}
+
+bool SyncSemaphore::wait(int timeoutMs)
+{
+	DWORD timeout = timeoutMs < 0 ? INFINITE : static_cast<DWORD>(timeoutMs);
+	return WaitForSingleObject(m_handle, timeout) == WAIT_OBJECT_0;
+}
+
+bool FrameSync::map(bool create, int renderers, string& error)
+{
+	m_owner = create;
+	if (create)
+	{
+		m_mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0,
+			static_cast<DWORD>(sizeof(Segment)), SEGMENT_NAME);
+	}
+	else
+	{
+		m_mapping = OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, SEGMENT_NAME);
+	}
+	if (m_mapping == NULL)
+	{
+		error = lastError(create ? "CreateFileMapping" : "OpenFileMapping");
+		return false;
+	}
+	void* view = MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Segment));
+	if (view == NULL)
+	{
+		error = lastError("MapViewOfFile");
+		return false;
+	}
+
+	if (create)
+	{
+		m_segment = new (view) Segment();
+		m_segment->renderers = static_cast<uint32_t>(renderers);
+	}
+	else
+	{
+		m_segment = static_cast<Segment*>(view);
+		if (m_segment->magic.load(memory_order_acquire) != SEGMENT_MAGIC)
+		{
+			error = "shared segment isn't initialised";
+			return false;
+		}
+	}
+	m_renderers = static_cast<int>(m_segment->renderers);
+
+	auto openSemaphore = [create](const wstring& name, LONG maximum) -> HANDLE
+	{
+		if (create)
+		{
+			return CreateSemaphoreW(NULL, 0, maximum, name.c_str());
+		}
+		return OpenSemaphoreW(SYNCHRONIZE | SEMAPHORE_MODIFY_STATE, FALSE, name.c_str());
+	};
+	const char* step = create ? "CreateSemaphore" : "OpenSemaphore";
+	m_frameDone.m_handle = openSemaphore(L"Global\\FrameDone", MAX_FRAMES_IN_FLIGHT);
+	if (m_frameDone.m_handle == NULL)
+	{
+		error = lastError(step);
+		return false;
+	}
+	for (int i = 0; i < m_renderers; ++i)
+	{
+		m_renderSignal[i].m_handle = openSemaphore(L"Global\\RenderSignal" + to_wstring(i), MAXLONG);
+		if (m_renderSignal[i].m_handle == NULL)
+		{
+			error = lastError(step);
+			return false;
+		}
+	}
+
+	if (create)
+	{
+		m_segment->magic.store(SEGMENT_MAGIC, memory_order_release);
+	}
+	return true;
+}
+
+FrameSync::~FrameSync()
+{
+	for (int i = 0; i < MAX_RENDERERS; ++i)
+	{
+		if (m_renderSignal[i].m_handle != NULL)
+		{
+			CloseHandle(m_renderSignal[i].m_handle);
+		}
+	}
+	if (m_frameDone.m_handle != NULL)
+	{
+		CloseHandle(m_frameDone.m_handle);
+	}
+	if (m_segment != nullptr)
+	{
+		UnmapViewOfFile(m_segment);
+	}
+	if (m_mapping != NULL)
+	{
+		CloseHandle(m_mapping);
+	}
+}
+
+bool RendererProcess::start(int id, string& error)
+{
+	STARTUPINFOW si = { sizeof(si) };
+	PROCESS_INFORMATION process = {};
+
+	wstring cmdLine = L"renderer.exe " + to_wstring(id);
+	vector<wchar_t> cmdLineBuf(cmdLine.begin(), cmdLine.end());
+	cmdLineBuf.push_back(0);
+
+	if (!CreateProcessW(NULL, cmdLineBuf.data(), NULL, NULL, FALSE, CREATE_NEW_CONSOLE, NULL, NULL, &si, &process))
+	{
+		error = lastError("CreateProcess");
+		return false;
+	}
+	lock_guard<mutex> lock(m_mutex);
+	m_process = process.hProcess;
+	m_thread = process.hThread;
+	return true;
+}
+
+bool RendererProcess::alive()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_process != nullptr && WaitForSingleObject(m_process, 0) == WAIT_TIMEOUT;
+}
+
+void RendererProcess::kill()
+{
+	lock_guard<mutex> lock(m_mutex);
+	if (m_process != nullptr)
+	{
+		TerminateProcess(m_process, 0);
+	}
+}
+
+void RendererProcess::terminate()
+{
+	lock_guard<mutex> lock(m_mutex);
+	if (m_process == nullptr)
+	{
+		return;
+	}
+	TerminateProcess(m_process, 0);
+	WaitForSingleObject(m_process, 1000);
+	CloseHandle(m_process);
+	CloseHandle(m_thread);
+	m_process = nullptr;
+	m_thread = nullptr;
+}
+
+#else // Linux
+
+namespace
+{
+	const char* SEGMENT_NAME = "/sync-frames";
+
+	string lastError(const char* step)
+	{
+		return string(step) + " failed: " + strerror(errno);
+	}
+
+	// Shared (not FUTEX_PRIVATE_FLAG) futex calls, as the words are mapped
+	// by several processes
+	long futexWait(atomic<uint32_t>& word, uint32_t expected, const timespec* deadline)
+	{
+		// FUTEX_WAIT_BITSET takes an absolute CLOCK_MONOTONIC deadline, so
+		// retries after spurious wakeups don't stretch the timeout
+		return syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_BITSET, expected,
+			deadline, nullptr, FUTEX_BITSET_MATCH_ANY);
+	}
+
+	void futexWake(atomic<uint32_t>& word, int count)
+	{
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, count, nullptr, nullptr, 0);
+	}
+
+	static_assert(sizeof(atomic<uint32_t>) == sizeof(uint32_t) && atomic<uint32_t>::is_always_lock_free,
+		"futex words must be plain 32-bit integers");
+}
+
+void SyncSemaphore::post()
+{
+	// Both seq_cst, pairing with wait(): either the waiter sees the new
+	// count before sleeping or this sees the waiter and wakes it
+	m_word->count.fetch_add(1, memory_order_seq_cst);
+	if (m_word->waiters.load(memory_order_seq_cst) != 0)
+	{
+		futexWake(m_word->count, 1);
+	}
+}
+
+bool SyncSemaphore::wait(int timeoutMs)
+{
+	timespec deadline = {};
+	if (timeoutMs >= 0)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		deadline.tv_sec += timeoutMs / 1000;
+		deadline.tv_nsec += static_cast<long>(timeoutMs % 1000) * 1000000;
+		if (deadline.tv_nsec >= 1000000000)
+		{
+			deadline.tv_sec += 1;
+			deadline.tv_nsec -= 1000000000;
+		}
+	}
+
+	for (;;)
+	{
+		uint32_t count = m_word->count.load(memory_order_relaxed);
+		while (count != 0)
+		{
+			if (m_word->count.compare_exchange_weak(count, count - 1, memory_order_acquire, memory_order_relaxed))
+			{
+				return true;
+			}
+		}
+
+		// Sleeps only while the count is still 0
+		m_word->waiters.fetch_add(1, memory_order_seq_cst);
+		long result = futexWait(m_word->count, 0, timeoutMs >= 0 ? &deadline : nullptr);
+		int waitError = errno;
+		m_word->waiters.fetch_sub(1, memory_order_relaxed);
+		if (result == -1 && waitError == ETIMEDOUT)
+		{
+			// One last look, in case the post raced the timeout
+			count = m_word->count.load(memory_order_relaxed);
+			return count != 0 && m_word->count.compare_exchange_strong(count, count - 1, memory_order_acquire);
+		}
+	}
+}
+
+bool FrameSync::map(bool create, int renderers, string& error)
+{
+	m_owner = create;
+	int fd;
+	if (create)
+	{
+		shm_unlink(SEGMENT_NAME);
+		fd = shm_open(SEGMENT_NAME, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+		if (fd != -1 && ftruncate(fd, sizeof(Segment)) == -1)
+		{
+			error = lastError("ftruncate");
+			close(fd);
+			return false;
+		}
+	}
+	else
+	{
+		fd = shm_open(SEGMENT_NAME, O_RDWR | O_CLOEXEC, 0);
+		struct stat info;
+		if (fd != -1 && (fstat(fd, &info) == -1 || static_cast<size_t>(info.st_size) < sizeof(Segment)))
+		{
+			error = "shared segment " + string(SEGMENT_NAME) + " is too small";
+			close(fd);
+			return false;
+		}
+	}
+	if (fd == -1)
+	{
+		error = lastError("shm_open");
+		return false;
+	}
+
+	void* memory = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (memory == MAP_FAILED)
+	{
+		error = lastError("mmap");
+		return false;
+	}
+
+	if (create)
+	{
+		m_segment = new (memory) Segment();
+		m_segment->renderers = static_cast<uint32_t>(renderers);
+		m_segment->magic.store(SEGMENT_MAGIC, memory_order_release);
+	}
+	else
+	{
+		m_segment = static_cast<Segment*>(memory);
+		if (m_segment->magic.load(memory_order_acquire) != SEGMENT_MAGIC)
+		{
+			error = "shared segment isn't initialised";
+			return false;
+		}
+	}
+	m_renderers = static_cast<int>(m_segment->renderers);
+	m_frameDone.m_word = &m_segment->frameDone;
+	for (int i = 0; i < m_renderers; ++i)
+	{
+		m_renderSignal[i].m_word = &m_segment->slots[i].renderSignal;
+	}
+	return true;
+}
+
+FrameSync::~FrameSync()
+{
+	if (m_segment != nullptr)
+	{
+		munmap(m_segment, sizeof(Segment));
+	}
+	if (m_owner)
+	{
+		shm_unlink(SEGMENT_NAME);
+	}
+}
+
+bool RendererProcess::start(int id, string& error)
+{
+	// The renderer lives next to this executable
+	char self[PATH_MAX];
+	ssize_t length = readlink("/proc/self/exe", self, sizeof(self) - 1);
+	if (length == -1)
+	{
+		error = lastError("readlink");
+		return false;
+	}
+	self[length] = '\0';
+	string path(self);
+	path = path.substr(0, path.rfind('/') + 1) + "renderer";
+
+	string idArg = to_string(id);
+	char* argv[] = { path.data(), idArg.data(), nullptr };
+	pid_t pid;
+	int result = posix_spawn(&pid, path.c_str(), nullptr, nullptr, argv, environ);
+	if (result != 0)
+	{
+		error = "posix_spawn " + path + " failed: " + strerror(result);
+		return false;
+	}
+	lock_guard<mutex> lock(m_mutex);
+	m_pid = pid;
+	return true;
+}
+
+bool RendererProcess::alive()
+{
+	lock_guard<mutex> lock(m_mutex);
+	if (m_pid == -1)
+	{
+		return false;
+	}
+	if (waitpid(m_pid, nullptr, WNOHANG) == 0)
+	{
+		return true;
+	}
+	m_pid = -1;	// Exited, and now reaped
+	return false;
+}
+
+void RendererProcess::kill()
+{
+	// The pid stays ours until it's reaped, which takes the mutex
+	lock_guard<mutex> lock(m_mutex);
+	if (m_pid != -1)
+	{
+		::kill(m_pid, SIGKILL);
+	}
+}
+
+void RendererProcess::terminate()
+{
+	lock_guard<mutex> lock(m_mutex);
+	if (m_pid == -1)
+	{
+		return;
+	}
+	::kill(m_pid, SIGKILL);
+	waitpid(m_pid, nullptr, 0);
+	m_pid = -1;
+}
+
+#endif
@@ -0,0 +1,277 @@
+// frame_sync.h : Process-shared primitives the coordinator and renderers
+// dispatch frames with.
+//
+// Frames are split into tiles queued across the renderers; a renderer that
+// runs out of tiles takes them from the others' queues.
+//
+// Windows: named semaphores Global\RenderSignal<i> / Global\FrameDone and a
+// named file mapping for the shared slots and queues.
+// Linux: one POSIX shared memory segment holding everything; semaphores are
+// futex words in it, so a post nobody waits on is a single atomic add and a
+// blocked waiter is woken directly by the kernel.
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+constexpr int MAX_RENDERERS = 64;
+constexpr int MAX_TILES = 64;	// Tiles one frame is split into at most
+constexpr int MAX_FRAMES_IN_FLIGHT = 8;
+constexpr int TILE_QUEUE_CAPACITY = MAX_TILES * MAX_FRAMES_IN_FLIGHT;
+constexpr int TIMING_RING_SIZE = 1024;	// Twice the tiles that can be in flight
+constexpr int WAIT_FOREVER = -1;
+constexpr int HEARTBEAT_INTERVAL_MS = 100;	// Renderers heartbeat at least this often while idle
+constexpr int COORDINATOR = MAX_RENDERERS;	// Tile queue taker id of the coordinator
+
+// Timestamp comparable across processes (QueryPerformanceCounter on
+// Windows, CLOCK_MONOTONIC on Linux)
+inline int64_t nowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Semaphore state as it lies in shared memory (Linux backend)
+struct FutexSemaphoreWord
+{
+	std::atomic<uint32_t> count;
+	std::atomic<uint32_t> waiters;
+};
+
+// One tile of a frame in flight. The frame number, not just its slot, so a
+// copy left over from recovery can't be mistaken for a tile of the later
+// frame that reuses the slot.
+struct TileRef
+{
+	int32_t frame;
+	int16_t tile;
+
+	int frameSlot() const { return frame % MAX_FRAMES_IN_FLIGHT; }
+
+	// As stored in RendererSlot::currentTile
+	int64_t id() const { return int64_t(frame) * MAX_TILES + tile; }
+	static TileRef fromId(int64_t id) { return TileRef{ int32_t(id / MAX_TILES), int16_t(id % MAX_TILES) }; }
+};
+
+// Queue of tiles in shared memory that its renderer and any idle renderer
+// take from. Process-shared mutexes aren't portable, so a spinlock guards
+// it; it is only held to move one entry. Everyone takes the oldest tile, so
+// the frame that has waited longest finishes first.
+//
+// taker is the renderer id or COORDINATOR; the lock records it so the lock
+// of a renderer killed while holding it can be broken. The coordinator
+// locks with a timeout, so it gets to do that rather than wait forever.
+struct TileQueue
+{
+	std::atomic<uint32_t> lock;	// Holder's taker + 1, or 0
+	uint32_t head;
+	uint32_t tail;
+	TileRef items[TILE_QUEUE_CAPACITY];
+
+	// False if the queue is full or the lock wasn't free within timeoutMs
+	bool push(TileRef tile, int taker, int timeoutMs = WAIT_FOREVER);
+
+	// Take the oldest tile and store its id in claim (the taker's
+	// currentTile) before letting go of the lock, so at any moment a tile is
+	// queued, claimed or done, even if the taker dies
+	bool pop(TileRef& tile, int taker, std::atomic<int64_t>& claim);
+
+	// Add the tiles of the given frame in the queue to tiles. False if the
+	// lock wasn't free within timeoutMs.
+	bool queued(int32_t frame, int taker, int timeoutMs, uint64_t& tiles);
+
+	// Release the lock if the given (dead) taker holds it. Every step of
+	// push and pop leaves the queue consistent, so this is safe.
+	void breakLock(int taker);
+};
+
+// When a renderer worked on one tile
+struct TileTiming
+{
+	int32_t frame;
+	int16_t tile;
+	int16_t stolenFrom;	// Renderer whose queue it came from, or -1
+	int64_t startNs;
+	int64_t endNs;
+};
+
+// Single-producer single-consumer ring the renderer records tile timings
+// in and the coordinator collects them from
+struct TimingRing
+{
+	std::atomic<uint32_t> head;	// Next to pop, written by the consumer
+	std::atomic<uint32_t> tail;	// Next to push, written by the producer
+	TileTiming records[TIMING_RING_SIZE];
+
+	bool push(const TileTiming& record)
+	{
+		uint32_t at = tail.load(std::memory_order_relaxed);
+		if (at - head.load(std::memory_order_acquire) == TIMING_RING_SIZE)
+		{
+			return false;
+		}
+		records[at % TIMING_RING_SIZE] = record;
+		tail.store(at + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(TileTiming& record)
+	{
+		uint32_t at = head.load(std::memory_order_relaxed);
+		if (at == tail.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+		record = records[at % TIMING_RING_SIZE];
+		head.store(at + 1, std::memory_order_release);
+		return true;
+	}
+};
+
+// A frame being rendered
+struct FrameSlot
+{
+	std::atomic<int32_t> frame;	// Frame number
+	std::atomic<int32_t> tiles;	// Tiles it was split into
+	std::atomic<uint64_t> tilesDone;	// Bit per tile rendered
+
+	// Mark a tile rendered. True for the call that completes the frame, which
+	// signals FrameDone; a tile redispatched after its renderer died may be
+	// rendered twice but only counts once.
+	bool finishTile(int tile)
+	{
+		uint64_t bit = uint64_t(1) << tile;
+		uint64_t before = tilesDone.fetch_or(bit, std::memory_order_acq_rel);
+		return (before & bit) == 0 && (before | bit) == allTiles();
+	}
+
+	bool tileDone(int tile) const
+	{
+		return (tilesDone.load(std::memory_order_acquire) & (uint64_t(1) << tile)) != 0;
+	}
+
+	bool done() const { return tilesDone.load(std::memory_order_acquire) == allTiles(); }
+
+	uint64_t allTiles() const
+	{
+		int count = tiles.load(std::memory_order_relaxed);
+		return count == 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+	}
+};
+
+static_assert(MAX_TILES <= 64, "FrameSlot::tilesDone has a bit per tile");
+
+// Per-renderer shared state
+struct RendererSlot
+{
+	FutexSemaphoreWord renderSignal;	// Counts the tiles pushed to tiles
+	TileQueue tiles;
+	std::atomic<int32_t> renderTimeMs;	// How long this renderer spends on a whole frame
+	TimingRing timing;
+	std::atomic<uint32_t> timingDropped;	// Records lost to a full ring
+	std::atomic<int64_t> heartbeatNs;	// nowNs() the renderer last showed signs of life
+	std::atomic<int64_t> currentTile;	// TileRef::id() of the tile being rendered, or -1
+};
+
+// Counting semaphore shared between processes
+class SyncSemaphore
+{
+public:
+	void post();
+
+	// Take one count, waiting up to timeoutMs (WAIT_FOREVER: no limit).
+	// Returns false on timeout.
+	bool wait(int timeoutMs = WAIT_FOREVER);
+
+private:
+	friend class FrameSync;
+
+#ifdef _WIN32
+	void* m_handle = nullptr;
+#else
+	FutexSemaphoreWord* m_word = nullptr;
+#endif
+};
+
+// The shared state of one coordinator and its renderers
+class FrameSync
+{
+public:
+	// Coordinator: create it for the given number of renderers, replacing
+	// whatever a crashed earlier run left behind
+	static std::unique_ptr<FrameSync> create(int renderers, std::string& error);
+
+	// Renderer: attach to the state the coordinator created
+	static std::unique_ptr<FrameSync> open(std::string& error);
+
+	~FrameSync();
+
+	FrameSync(const FrameSync&) = delete;
+	FrameSync& operator=(const FrameSync&) = delete;
+
+	int renderers() const { return m_renderers; }
+
+	// Coordinator -> renderer: a tile was pushed to its queue. Tiles other
+	// renderers steal leave their count behind, so a wake may find nothing.
+	SyncSemaphore& renderSignal(int renderer) { return m_renderSignal[renderer]; }
+
+	// Renderers -> coordinator: the last tile of a frame landed
+	SyncSemaphore& frameDone() { return m_frameDone; }
+
+	RendererSlot& slot(int renderer);
+	FrameSlot& frame(int frameSlot);
+
+private:
+	FrameSync() = default;
+
+	bool map(bool create, int renderers, std::string& error);
+
+	struct Segment;
+	Segment* m_segment = nullptr;
+	bool m_owner = false;
+	int m_renderers = 0;
+	SyncSemaphore m_renderSignal[MAX_RENDERERS];
+	SyncSemaphore m_frameDone;
+#ifdef _WIN32
+	void* m_mapping = nullptr;
+#endif
+};
+
+// A renderer child process
+class RendererProcess
+{
+public:
+	RendererProcess() = default;
+	~RendererProcess() { terminate(); }
+
+	RendererProcess(const RendererProcess&) = delete;
+	RendererProcess& operator=(const RendererProcess&) = delete;
+
+	// Launch the renderer executable next to this one with the given id
+	bool start(int id, std::string& error);
+
+	// False once the process has exited (or was never started)
+	bool alive();
+
+	// Kill the process if it is still running and reap it
+	void terminate();
+
+	// Kill the process without waiting for it; alive() turns false once it
+	// is gone. Unlike the others, safe to call from any thread.
+	void kill();
+
+private:
+	std::mutex m_mutex;	// For kill()
+#ifdef _WIN32
+	void* m_process = nullptr;
+	void* m_thread = nullptr;
+#else
+	int m_pid = -1;
+#endif
+};
@@ -1,10 +1,11 @@
 // renderer.cpp : Rendering program that runs independently
 //
 
+#include "frame_sync.h"
+
 #include <iostream>
 #include <thread>
 #include <chrono>
-#include <Windows.h>
 #include <string>
 
 using namespace std;
@@ -13,42 +14,98 @@ int main(int argc, char* argv[])
 {
 	if (argc < 2)
 	{
-		cerr << "Usage: renderer.exe <id>" << endl;
+		cerr << "Usage: renderer <id>" << endl;
 		return 1;
 	}
 	
 	int rendererId = atoi(argv[1]);
 	
-	// Open existing named semaphores with renderer-specific names
-	wstring renderSemaName = L"Global\\RenderSignal" + to_wstring(rendererId);
-	wstring renderingSemaName = L"Global\\RenderingDone" + to_wstring(rendererId);
-	
-	HANDLE renderSema = OpenSemaphoreW(SYNCHRONIZE | SEMAPHORE_MODIFY_STATE, FALSE, renderSemaName.c_str());
-	HANDLE renderingSema = OpenSemaphoreW(SYNCHRONIZE | SEMAPHORE_MODIFY_STATE, FALSE, renderingSemaName.c_str());
-	
-	if (renderSema == NULL || renderingSema == NULL)
+	// Attach to the semaphores the coordinator created
+	string error;
+	unique_ptr<FrameSync> sync = FrameSync::open(error);
+	if (!sync || rendererId < 0 || rendererId >= sync->renderers())
 	{
-		cerr << "Renderer " << rendererId << ": Failed to open semaphores. Error: " << GetLastError() << endl;
+		cerr << "Renderer " << rendererId << ": Failed to open semaphores. "
+			<< (sync ? "No such renderer" : error) << endl;
 		return 1;
 	}
+	SyncSemaphore& renderSema = sync->renderSignal(rendererId);
+	RendererSlot& slot = sync->slot(rendererId);
+	const int numRenderers = sync->renderers();
 	
 	cout << "Renderer " << rendererId << " started." << endl;
+	cout << "Renderer " << rendererId << ": Waiting for render signal..." << endl;
 	
 	while (true)
 	{
-		cout << "Renderer " << rendererId << ": Waiting for render signal..." << endl;
-		DWORD result = WaitForSingleObject(renderSema, INFINITE);
+		// Timed, so the coordinator keeps hearing from an idle renderer
+		slot.heartbeatNs.store(nowNs(), memory_order_relaxed);
+		if (!renderSema.wait(HEARTBEAT_INTERVAL_MS))
+		{
+			continue;
+		}
 		
-		if (result == WAIT_OBJECT_0)
+		// Work through this renderer's own tiles, then the others', until
+		// there are none left anywhere
+		bool rendered = false;
+		while (true)
 		{
-			cout << "Renderer " << rendererId << ": Rendering..." << endl;
-			this_thread::sleep_for(chrono::milliseconds(1000));
-			ReleaseSemaphore(renderingSema, 1, NULL);
+			TileRef tile;
+			int from = 0;
+			while (from < numRenderers && !sync->slot((rendererId + from) % numRenderers).tiles.pop(tile, rendererId, slot.currentTile))
+			{
+				++from;
+			}
+			if (from == numRenderers)
+			{
+				break;
+			}
+			
+			// pop claimed it as currentTile; if this process dies before it's
+			// done, the coordinator puts it back
+			slot.heartbeatNs.store(nowNs(), memory_order_relaxed);
+			
+			// Drop a copy left over from recovery whose frame is finished or
+			// has handed its slot on to a later one
+			FrameSlot& frame = sync->frame(tile.frameSlot());
+			if (frame.frame.load(memory_order_relaxed) != tile.frame || frame.tileDone(tile.tile))
+			{
+				slot.currentTile.store(-1, memory_order_relaxed);
+				continue;
+			}
+			int tiles = frame.tiles.load(memory_order_relaxed);
+			cout << "Renderer " << rendererId << ": Rendering frame " << tile.frame + 1
+				<< " tile " << tile.tile + 1 << "/" << tiles;
+			if (from != 0)
+			{
+				cout << " (stolen from renderer " << (rendererId + from) % numRenderers << ")";
+			}
+			cout << "..." << endl;
+			
+			TileTiming timing = { tile.frame, tile.tile,
+				int16_t(from != 0 ? (rendererId + from) % numRenderers : -1), nowNs(), 0 };
+			this_thread::sleep_for(chrono::microseconds(slot.renderTimeMs.load(memory_order_relaxed) * 1000 / tiles));
+			timing.endNs = nowNs();
+			
+			// Recorded before the tile counts as done, so the coordinator has
+			// every timing of a frame once it sees the frame finish
+			if (!slot.timing.push(timing))
+			{
+				slot.timingDropped.fetch_add(1, memory_order_relaxed);
+			}
+			if (frame.finishTile(tile.tile))
+			{
+				sync->frameDone().post();
+			}
+			slot.currentTile.store(-1, memory_order_relaxed);
+			rendered = true;
+		}
+		
+		if (rendered)
+		{
+			cout << "Renderer " << rendererId << ": Waiting for render signal..." << endl;
 		}
 	}
 	
-	CloseHandle(renderSema);
-	CloseHandle(renderingSema);
-	
 	return 0;
 }
\ No newline at end of file
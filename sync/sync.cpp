@@ -1,52 +1,330 @@
 ﻿// sync.cpp : Defines the entry point for the application.
 //
+// Usage: sync [--renderers=N] [--frames=N] [--tiles=N] [--in-flight=N] [--render-ms=MS] [--slow=ID:MS]
+//             [--trace=PATH] [--hang-ms=MS] [--fault-inject=MS]
+//
+// Each frame is split into --tiles tiles spread over the renderers' queues;
+// renderers that run dry take tiles from the others, and a frame is done
+// when its last tile lands, so one frame takes about --render-ms divided by
+// the renderer count. Up to --in-flight frames are dispatched and not yet
+// presented, and frames are presented strictly in order. --slow makes one
+// renderer take MS per frame's worth of tiles. At exit a timing summary is
+// printed, and --trace writes the run as Chrome trace JSON.
+//
+// A renderer that exits, or stops heartbeating for --hang-ms (more than
+// twice the time one tile takes), is killed and restarted, and the tile it was on
+// goes back in its queue. --fault-inject kills a random renderer at random
+// moments, every MS on average, to exercise that.
+//
 
+#include "frame_sync.h"
+#include "telemetry.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <condition_variable>
+#include <mutex>
+#include <random>
 #include <thread>
-#include <Windows.h>
 #include <vector>
 #include <string>
 #include <iostream>
 
 using namespace std;
 
-const int NUM_RENDERERS = 4;
+struct Options
+{
+	int renderers = 4;
+	int frames = 100;
+	int tiles = 0;	// 0: four per renderer
+	int inFlight = 2;
+	int renderMs = 1000;
+	int slowRenderer = -1;
+	int slowMs = 0;
+	string tracePath;
+	int hangMs = 2000;
+	int faultInjectMs = 0;	// 0: off
+};
 
-	int main()
+bool parseOptions(int argc, char* argv[], Options& options)
 {
-	vector<HANDLE> renderSemas(NUM_RENDERERS);
-	vector<HANDLE> renderingSemas(NUM_RENDERERS);
-	vector<PROCESS_INFORMATION> processes(NUM_RENDERERS);
-	
-	// Create named semaphores for each renderer
-	for (int i = 0; i < NUM_RENDERERS; ++i)
+	for (int i = 1; i < argc; ++i)
 	{
-		wstring renderSemaName = L"Global\\RenderSignal" + to_wstring(i);
-		wstring renderingSemaName = L"Global\\RenderingDone" + to_wstring(i);
-		
-		renderSemas[i] = CreateSemaphoreW(NULL, 0, 10, renderSemaName.c_str());
-		renderingSemas[i] = CreateSemaphoreW(NULL, 1, 10, renderingSemaName.c_str());
-		
-		if (renderSemas[i] == NULL || renderingSemas[i] == NULL)
+		const char* arg = argv[i];
+		const char* value = strchr(arg, '=');
+		string name = value != nullptr ? string(arg, value - arg) : string(arg);
+		value = value != nullptr ? value + 1 : "";
+		if (name == "--renderers")
 		{
-			cerr << "Failed to create semaphores for renderer " << i << ". Error: " << GetLastError() << endl;
-			return 1;
+			options.renderers = atoi(value);
+		}
+		else if (name == "--frames")
+		{
+			options.frames = atoi(value);
+		}
+		else if (name == "--tiles")
+		{
+			options.tiles = atoi(value);
+		}
+		else if (name == "--in-flight")
+		{
+			options.inFlight = atoi(value);
+		}
+		else if (name == "--render-ms")
+		{
+			options.renderMs = atoi(value);
+		}
+		else if (name == "--trace" && *value != '\0')
+		{
+			options.tracePath = value;
+		}
+		else if (name == "--hang-ms")
+		{
+			options.hangMs = atoi(value);
+		}
+		else if (name == "--fault-inject")
+		{
+			options.faultInjectMs = atoi(value);
+		}
+		else if (name == "--slow" && strchr(value, ':') != nullptr)
+		{
+			options.slowRenderer = atoi(value);
+			options.slowMs = atoi(strchr(value, ':') + 1);
+		}
+		else
+		{
+			return false;
 		}
 	}
+	if (options.tiles == 0)
+	{
+		options.tiles = min(options.renderers * 4, MAX_TILES);
+	}
+	if (options.tiles < 1 || options.tiles > MAX_TILES)
+	{
+		return false;
+	}
+
+	// A renderer only heartbeats between tiles, so one busy with a tile for
+	// longer than --hang-ms would be killed and restarted over and over
+	int slowestTileMs = max(options.renderMs, options.slowRenderer >= 0 ? options.slowMs : 0) / options.tiles;
+	return options.renderers >= 1 && options.renderers <= MAX_RENDERERS && options.frames >= 1
+		&& options.inFlight >= 1 && options.inFlight <= MAX_FRAMES_IN_FLIGHT && options.renderMs >= 0
+		&& options.hangMs > max(HEARTBEAT_INTERVAL_MS, 2 * slowestTileMs) && options.faultInjectMs >= 0;
+}
+
+struct Recovery
+{
+	int restarts = 0;
+	int redispatched = 0;
+};
+
+// Queue a tile that was taken away from a dead renderer or went missing,
+// starting with the given renderer's queue. Gives up if every queue is full
+// or locked; the lost tile sweep then finds it later.
+void requeueTile(FrameSync& sync, TileRef tile, int renderer, Recovery& recovery)
+{
+	for (int i = 0; i < sync.renderers(); ++i)
+	{
+		int to = (renderer + i) % sync.renderers();
+		if (sync.slot(to).tiles.push(tile, COORDINATOR, HEARTBEAT_INTERVAL_MS))
+		{
+			sync.renderSignal(to).post();
+			++recovery.redispatched;
+			return;
+		}
+	}
+}
+
+// Whether a tile a dead renderer had claimed still has to be rendered: its
+// frame still holds the slot, the tile isn't done, and it isn't still queued
+// (the renderer may have died in pop after claiming it but before taking it
+// off the queue). False if a queue stayed locked; the lost tile sweep
+// catches the tile then.
+bool needsRequeue(FrameSync& sync, TileRef tile)
+{
+	FrameSlot& frame = sync.frame(tile.frameSlot());
+	if (frame.frame.load(memory_order_relaxed) != tile.frame || frame.tileDone(tile.tile))
+	{
+		return false;
+	}
+	uint64_t queued = 0;
+	for (int i = 0; i < sync.renderers(); ++i)
+	{
+		if (!sync.slot(i).tiles.queued(tile.frame, COORDINATOR, HEARTBEAT_INTERVAL_MS, queued))
+		{
+			return false;
+		}
+	}
+	return (queued & (uint64_t(1) << tile.tile)) == 0;
+}
+
+// Kill and restart a renderer, and put the tile it was rendering back in
+// its queue for the replacement, or whoever steals it first
+bool replaceRenderer(FrameSync& sync, RendererProcess& process, int renderer, Recovery& recovery, string& error)
+{
+	RendererSlot& slot = sync.slot(renderer);
+	process.terminate();
+
+	// It may have died in the middle of stealing from any queue
+	for (int i = 0; i < sync.renderers(); ++i)
+	{
+		sync.slot(i).tiles.breakLock(renderer);
+	}
+
+	int64_t current = slot.currentTile.exchange(-1, memory_order_relaxed);
+	if (current >= 0 && needsRequeue(sync, TileRef::fromId(current)))
+	{
+		requeueTile(sync, TileRef::fromId(current), renderer, recovery);
+	}
+
+	// Grace period while it starts
+	slot.heartbeatNs.store(nowNs(), memory_order_relaxed);
+	++recovery.restarts;
+	return process.start(renderer, error);
+}
+
+// Replace every renderer that exited or stopped heartbeating. False if one
+// couldn't be restarted.
+bool checkRenderers(FrameSync& sync, vector<RendererProcess>& processes, int64_t hangNs, Recovery& recovery, string& error)
+{
+	int64_t now = nowNs();
+	for (int i = 0; i < sync.renderers(); ++i)
+	{
+		bool dead = !processes[i].alive();
+		if (!dead && now - sync.slot(i).heartbeatNs.load(memory_order_relaxed) < hangNs)
+		{
+			continue;
+		}
+		cout << "Renderer " << i << (dead ? " died" : " stopped responding") << ", restarting it..." << endl;
+		if (!replaceRenderer(sync, processes[i], i, recovery, error))
+		{
+			error = "Failed to restart renderer " + to_string(i) + ". " + error;
+			return false;
+		}
+	}
+	return true;
+}
+
+// Requeue the tiles of a frame that are neither done, queued nor claimed by
+// a renderer. A tile only moves forward through those (queued, claimed,
+// done) unless this thread moves it back, so looking at them in that order
+// can't miss one. Backstop for any way of losing a tile not handled above.
+void requeueLostTiles(FrameSync& sync, int frameNumber, Recovery& recovery)
+{
+	FrameSlot& frame = sync.frame(frameNumber % MAX_FRAMES_IN_FLIGHT);
+	uint64_t found = 0;
+	for (int i = 0; i < sync.renderers(); ++i)
+	{
+		if (!sync.slot(i).tiles.queued(frameNumber, COORDINATOR, HEARTBEAT_INTERVAL_MS, found))
+		{
+			return;	// Try again on a later pass
+		}
+	}
+	for (int i = 0; i < sync.renderers(); ++i)
+	{
+		int64_t current = sync.slot(i).currentTile.load(memory_order_relaxed);
+		if (current >= 0 && TileRef::fromId(current).frame == frameNumber)
+		{
+			found |= uint64_t(1) << TileRef::fromId(current).tile;
+		}
+	}
+	found |= frame.tilesDone.load(memory_order_acquire);
+
+	uint64_t lost = frame.allTiles() & ~found;
+	for (int tile = 0; tile < MAX_TILES; ++tile)
+	{
+		if ((lost & (uint64_t(1) << tile)) != 0)
+		{
+			cout << "Frame " << frameNumber + 1 << ": Tile " << tile + 1 << " was lost, requeueing it" << endl;
+			requeueTile(sync, TileRef{ frameNumber, int16_t(tile) }, tile % sync.renderers(), recovery);
+		}
+	}
+}
+
+// Kills a random renderer at random moments, every intervalMs on average,
+// whatever it is doing. Stops when it goes out of scope, so no way out of
+// main leaves the thread running (which would abort).
+class FaultInjector
+{
+public:
+	~FaultInjector() { stop(); }
+
+	void start(vector<RendererProcess>& processes, int intervalMs)
+	{
+		m_thread = thread([this, &processes, intervalMs]
+			{
+				mt19937 random(random_device{}());
+				uniform_int_distribution<int> interval(0, 2 * intervalMs);
+				unique_lock<mutex> lock(m_mutex);
+				while (!m_stop.wait_for(lock, chrono::milliseconds(interval(random)), [this] { return m_stopping; }))
+				{
+					processes[random() % processes.size()].kill();
+					++m_injected;
+				}
+			});
+	}
+
+	void stop()
+	{
+		if (!m_thread.joinable())
+		{
+			return;
+		}
+		{
+			lock_guard<mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_stop.notify_one();
+		m_thread.join();
+	}
+
+	int injected() const { return m_injected; }
+
+private:
+	mutex m_mutex;
+	condition_variable m_stop;
+	bool m_stopping = false;
+	atomic<int> m_injected = 0;
+	thread m_thread;
+};
+
+	int main(int argc, char* argv[])
+{
+	Options options;
+	if (!parseOptions(argc, argv, options))
+	{
+		cerr << "Usage: " << argv[0] << " [--renderers=N] [--frames=N] [--tiles=N] [--in-flight=N] [--render-ms=MS] [--slow=ID:MS] [--trace=PATH] [--hang-ms=MS] [--fault-inject=MS]" << endl;
+		return 1;
+	}
+	const int numRenderers = options.renderers;
+
+	// Create the shared semaphores for each renderer
+	string error;
+	unique_ptr<FrameSync> sync = FrameSync::create(numRenderers, error);
+	if (!sync)
+	{
+		cerr << "Failed to create frame sync state: " << error << endl;
+		return 1;
+	}
+	for (int i = 0; i < numRenderers; ++i)
+	{
+		int renderMs = i == options.slowRenderer ? options.slowMs : options.renderMs;
+		sync->slot(i).renderTimeMs.store(renderMs, memory_order_relaxed);
+		sync->slot(i).currentTile.store(-1, memory_order_relaxed);
+		sync->slot(i).heartbeatNs.store(nowNs(), memory_order_relaxed);
+	}
+	vector<RendererProcess> processes(numRenderers);
 	
 	// Start renderer processes
-	cout << "Starting " << NUM_RENDERERS << " renderer processes..." << endl;
+	cout << "Starting " << numRenderers << " renderer processes..." << endl;
 	
-	for (int i = 0; i < NUM_RENDERERS; ++i)
+	for (int i = 0; i < numRenderers; ++i)
 	{
-		STARTUPINFOW si = { sizeof(si) };
-		
-		wstring cmdLine = L"renderer.exe " + to_wstring(i);
-		vector<wchar_t> cmdLineBuf(cmdLine.begin(), cmdLine.end());
-		cmdLineBuf.push_back(0);
-		
-		if (!CreateProcessW(NULL, cmdLineBuf.data(), NULL, NULL, FALSE, CREATE_NEW_CONSOLE, NULL, NULL, &si, &processes[i]))
+		if (!processes[i].start(i, error))
 		{
-			cerr << "Failed to start renderer " << i << ". Error: " << GetLastError() << endl;
+			cerr << "Failed to start renderer " << i << ". " << error << endl;
 			return 1;
 		}
 		
@@ -56,30 +334,137 @@ const int NUM_RENDERERS = 4;
 	// Wait a bit for renderers to initialize
 	this_thread::sleep_for(chrono::milliseconds(500));
 	
-	// run for 100 frames, cycling through renderers
-	for (int frame = 0; frame < 100; ++frame)
+	const int frames = options.frames;
+	const int tiles = options.tiles;
+	vector<int64_t> dispatchNs(frames, 0);
+	vector<int64_t> doneNs(frames, 0);
+	int nextFrame = 0;		// Next to dispatch
+	int nextPresent = 0;	// Next to present
+	int nextRenderer = 0;	// Gets the first tile of the next frame
+	vector<int64_t> sweptNs(frames, 0);	// When lost tiles were last looked for
+	FrameTimeline timeline(frames, numRenderers);
+	const int64_t hangNs = options.hangMs * int64_t(1000000);
+	Recovery recovery;
+	int64_t startNs = nowNs();
+	
+	// Declared after processes, so on an early return it stops before their
+	// destructors terminate the renderers
+	FaultInjector faultInjector;
+	if (options.faultInjectMs > 0)
+	{
+		faultInjector.start(processes, options.faultInjectMs);
+	}
+	
+	while (nextPresent < frames)
 	{
-		int rendererIdx = frame % NUM_RENDERERS;
+		// Deal with failed renderers first, as one may have died holding a
+		// queue lock the dispatch below needs
+		if (!checkRenderers(*sync, processes, hangNs, recovery, error))
+		{
+			cerr << error << endl;
+			return 1;
+		}
+		int64_t now = nowNs();
+		for (int frame = nextPresent; frame < nextFrame; ++frame)
+		{
+			if (doneNs[frame] == 0 && now - sweptNs[frame] > hangNs)
+			{
+				requeueLostTiles(*sync, frame, recovery);
+				sweptNs[frame] = now;
+			}
+		}
+		
+		// Frames up to inFlight ahead of the one being presented; their slot
+		// was last used by a frame already presented
+		while (nextFrame < frames && nextFrame - nextPresent < options.inFlight)
+		{
+			int frameSlot = nextFrame % MAX_FRAMES_IN_FLIGHT;
+			FrameSlot& slot = sync->frame(frameSlot);
+			slot.frame.store(nextFrame, memory_order_relaxed);
+			slot.tiles.store(tiles, memory_order_relaxed);
+			slot.tilesDone.store(0, memory_order_relaxed);
+			
+			// Deal the tiles out round-robin; the queue lock publishes the slot.
+			// Each queue holds at most MAX_TILES tiles of each frame in flight.
+			cout << "Frame " << nextFrame + 1 << ": Queueing " << tiles << " tiles..." << endl;
+			dispatchNs[nextFrame] = nowNs();
+			sweptNs[nextFrame] = dispatchNs[nextFrame];
+			timeline.dispatched(nextFrame, dispatchNs[nextFrame]);
+			for (int tile = 0; tile < tiles; ++tile)
+			{
+				int renderer = (nextRenderer + tile) % numRenderers;
+				while (!sync->slot(renderer).tiles.push(TileRef{ nextFrame, int16_t(tile) }, COORDINATOR, HEARTBEAT_INTERVAL_MS))
+				{
+					// Locked by a renderer that died holding it; replacing it frees the lock
+					if (!checkRenderers(*sync, processes, hangNs, recovery, error))
+					{
+						cerr << error << endl;
+						return 1;
+					}
+				}
+				sync->renderSignal(renderer).post();
+			}
+			nextRenderer = (nextRenderer + tiles) % numRenderers;
+			++nextFrame;
+		}
+		
+		// One count per finished frame. Timed, to keep an eye on the renderers,
+		// and a frame whose last renderer died before posting is still seen
+		// here on the next pass.
+		sync->frameDone().wait(HEARTBEAT_INTERVAL_MS);
 		
-		WaitForSingleObject(renderingSemas[rendererIdx], INFINITE);
-		cout << "Frame " << frame + 1 << ": Signaling renderer " << rendererIdx << "..." << endl;
-		ReleaseSemaphore(renderSemas[rendererIdx], 1, NULL);
-		this_thread::sleep_for(chrono::milliseconds(1));
+		timeline.collect(*sync);
+		for (int frame = nextPresent; frame < nextFrame; ++frame)
+		{
+			if (doneNs[frame] == 0 && sync->frame(frame % MAX_FRAMES_IN_FLIGHT).done())
+			{
+				doneNs[frame] = nowNs();
+				timeline.completed(frame, doneNs[frame]);
+			}
+		}
+		
+		// Reassemble in frame order
+		while (nextPresent < nextFrame && doneNs[nextPresent] != 0)
+		{
+			cout << "Frame " << nextPresent + 1 << ": Presented after "
+				<< (doneNs[nextPresent] - dispatchNs[nextPresent]) / 1000000.0 << " ms" << endl;
+			++nextPresent;
+		}
 	}
+	int64_t endNs = nowNs();
+	double seconds = (endNs - startNs) / 1e9;
+	
+	faultInjector.stop();
 	
 	// Terminate all renderer processes
 	cout << "Terminating renderer processes..." << endl;
-	for (int i = 0; i < NUM_RENDERERS; ++i)
+	for (int i = 0; i < numRenderers; ++i)
 	{
-		TerminateProcess(processes[i].hProcess, 0);
-		WaitForSingleObject(processes[i].hProcess, 1000);
-		
-		CloseHandle(processes[i].hProcess);
-		CloseHandle(processes[i].hThread);
-		CloseHandle(renderSemas[i]);
-		CloseHandle(renderingSemas[i]);
+		processes[i].terminate();
 	}
 	
+	cout << frames << " frames of " << tiles << " tiles in " << seconds << " s (" << frames / seconds
+		<< " frames/s, up to " << options.inFlight << " in flight)" << endl;
+	timeline.report(cout, startNs, endNs);
+	if (faultInjector.injected() != 0)
+	{
+		cout << "Injected " << faultInjector.injected() << " faults" << endl;
+	}
+	if (recovery.restarts != 0)
+	{
+		cout << "Restarted " << recovery.restarts << " renderers, " << recovery.redispatched << " tiles redispatched" << endl;
+	}
+	if (!options.tracePath.empty())
+	{
+		if (timeline.writeChromeTrace(options.tracePath, error))
+		{
+			cout << "Trace written to " << options.tracePath << endl;
+		}
+		else
+		{
+			cerr << "Failed to write trace: " << error << endl;
+		}
+	}
 	cout << "All frames completed." << endl;
 	return 0;
 }
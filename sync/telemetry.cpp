@@ -0,0 +1,216 @@
+// telemetry.cpp : Frame timing summary and Chrome trace export
+//
+
+#include "telemetry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+using namespace std;
+
+namespace
+{
+	// Nearest-rank percentile of sorted nanosecond values, in ms
+	double percentileMs(const vector<int64_t>& sorted, double percent)
+	{
+		if (sorted.empty())
+		{
+			return 0;
+		}
+		size_t rank = static_cast<size_t>(ceil(percent / 100 * sorted.size()));
+		return sorted[max<size_t>(rank, 1) - 1] / 1e6;
+	}
+
+	void printDistribution(ostream& out, const char* name, vector<int64_t> values)
+	{
+		sort(values.begin(), values.end());
+		out << name << ": p50 " << percentileMs(values, 50) << " ms, p90 " << percentileMs(values, 90)
+			<< " ms, p99 " << percentileMs(values, 99) << " ms, max " << percentileMs(values, 100) << " ms" << endl;
+	}
+}
+
+FrameTimeline::FrameTimeline(int frames, int renderers)
+	: m_frames(frames), m_renderers(renderers)
+{
+	m_tiles.reserve(static_cast<size_t>(frames) * 4);
+}
+
+void FrameTimeline::collect(FrameSync& sync)
+{
+	m_dropped = 0;
+	for (int i = 0; i < m_renderers; ++i)
+	{
+		RendererSlot& slot = sync.slot(i);
+		Tile tile = { i, TileTiming{} };
+		while (slot.timing.pop(tile.timing))
+		{
+			m_tiles.push_back(tile);
+		}
+		m_dropped += slot.timingDropped.load(memory_order_relaxed);
+	}
+}
+
+void FrameTimeline::report(ostream& out, int64_t startNs, int64_t endNs) const
+{
+	// Frames are presented in order, so one is on screen once it and every
+	// frame before it are done
+	vector<int64_t> frameTimes;
+	vector<int64_t> intervals;
+	int64_t presentedNs = 0;
+	for (const Frame& frame : m_frames)
+	{
+		if (frame.doneNs == 0)
+		{
+			continue;
+		}
+		frameTimes.push_back(frame.doneNs - frame.dispatchNs);
+		int64_t presentNs = max(presentedNs, frame.doneNs);
+		if (presentedNs != 0)
+		{
+			intervals.push_back(presentNs - presentedNs);
+		}
+		presentedNs = presentNs;
+	}
+
+	// A renderer killed after rendering a tile but before marking it done
+	// leaves a record of a tile that was rendered again; only the last one
+	// counted
+	vector<int> counted(m_frames.size() * MAX_TILES, -1);
+	for (size_t i = 0; i < m_tiles.size(); ++i)
+	{
+		const TileTiming& timing = m_tiles[i].timing;
+		int& index = counted[timing.frame * size_t(MAX_TILES) + timing.tile];
+		if (index < 0 || m_tiles[index].timing.endNs < timing.endNs)
+		{
+			index = static_cast<int>(i);
+		}
+	}
+
+	vector<int64_t> lastEnd(m_frames.size(), 0);
+	vector<int64_t> queueing;
+	vector<int64_t> busyNs(m_renderers, 0);
+	vector<int> tiles(m_renderers, 0);
+	vector<int> stolen(m_renderers, 0);
+	size_t rerendered = m_tiles.size();
+	for (int index : counted)
+	{
+		if (index < 0)
+		{
+			continue;
+		}
+		--rerendered;
+		const Tile& tile = m_tiles[index];
+		const TileTiming& timing = tile.timing;
+		queueing.push_back(timing.startNs - m_frames[timing.frame].dispatchNs);
+		lastEnd[timing.frame] = max(lastEnd[timing.frame], timing.endNs);
+		busyNs[tile.renderer] += timing.endNs - timing.startNs;
+		++tiles[tile.renderer];
+		stolen[tile.renderer] += timing.stolenFrom >= 0 ? 1 : 0;
+	}
+
+	// From the last tile ending to the coordinator noticing
+	vector<int64_t> notice;
+	for (size_t i = 0; i < m_frames.size(); ++i)
+	{
+		if (m_frames[i].doneNs != 0 && lastEnd[i] != 0)
+		{
+			notice.push_back(m_frames[i].doneNs - lastEnd[i]);
+		}
+	}
+
+	printDistribution(out, "Frame time (dispatch to done)", frameTimes);
+	printDistribution(out, "Frame interval", intervals);
+	if (!intervals.empty())
+	{
+		double mean = 0;
+		for (int64_t interval : intervals)
+		{
+			mean += interval;
+		}
+		mean /= intervals.size();
+		double variance = 0;
+		for (int64_t interval : intervals)
+		{
+			variance += (interval - mean) * (interval - mean);
+		}
+		out << "Jitter: " << sqrt(variance / intervals.size()) / 1e6 << " ms standard deviation around a "
+			<< mean / 1e6 << " ms interval" << endl;
+	}
+	printDistribution(out, "Queueing delay (dispatch to tile start)", queueing);
+	printDistribution(out, "Completion notice (last tile to coordinator)", notice);
+
+	double runNs = static_cast<double>(max<int64_t>(endNs - startNs, 1));
+	for (int i = 0; i < m_renderers; ++i)
+	{
+		out << "Renderer " << i << ": " << tiles[i] << " tiles, " << stolen[i] << " stolen, "
+			<< busyNs[i] / 1e6 << " ms busy (" << 100 * busyNs[i] / runNs << "% utilised)" << endl;
+	}
+	if (rerendered != 0)
+	{
+		out << rerendered << " tiles rendered again after their renderer died" << endl;
+	}
+	if (m_dropped != 0)
+	{
+		out << m_dropped << " tile timings lost to full rings" << endl;
+	}
+}
+
+bool FrameTimeline::writeChromeTrace(const string& path, string& error) const
+{
+	ofstream out(path);
+	if (!out)
+	{
+		error = "can't open " + path;
+		return false;
+	}
+
+	int64_t originNs = m_frames.empty() ? 0 : m_frames[0].dispatchNs;
+	auto micros = [originNs](int64_t timeNs) { return (timeNs - originNs) / 1000.0; };
+
+	// Process 0 is the coordinator with one track per frame slot, process 1
+	// the renderers with one track each
+	out << fixed << setprecision(3);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << endl;
+	out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"Coordinator\"}}," << endl;
+	out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Renderers\"}}";
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		out << "," << endl << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i
+			<< ",\"args\":{\"name\":\"Frame slot " << i << "\"}}";
+	}
+	for (int i = 0; i < m_renderers; ++i)
+	{
+		out << "," << endl << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i
+			<< ",\"args\":{\"name\":\"Renderer " << i << "\"}}";
+	}
+
+	for (size_t i = 0; i < m_frames.size(); ++i)
+	{
+		const Frame& frame = m_frames[i];
+		if (frame.doneNs == 0)
+		{
+			continue;
+		}
+		out << "," << endl << "{\"name\":\"Frame " << i + 1 << "\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+			<< i % MAX_FRAMES_IN_FLIGHT << ",\"ts\":" << micros(frame.dispatchNs)
+			<< ",\"dur\":" << micros(frame.doneNs) - micros(frame.dispatchNs) << "}";
+	}
+	for (const Tile& tile : m_tiles)
+	{
+		const TileTiming& timing = tile.timing;
+		out << "," << endl << "{\"name\":\"Frame " << timing.frame + 1 << " tile " << timing.tile + 1
+			<< "\",\"cat\":\"tile\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tile.renderer
+			<< ",\"ts\":" << micros(timing.startNs) << ",\"dur\":" << micros(timing.endNs) - micros(timing.startNs)
+			<< ",\"args\":{\"frame\":" << timing.frame + 1 << ",\"stolen_from\":" << timing.stolenFrom << "}}";
+	}
+	out << endl << "]}" << endl;
+
+	if (!out)
+	{
+		error = "writing " + path + " failed";
+		return false;
+	}
+	return true;
+}
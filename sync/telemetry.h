@@ -0,0 +1,53 @@
+// telemetry.h : Frame timing the coordinator records itself and collects
+// from the renderers, summarised at exit and exported as a Chrome trace.
+//
+// Per frame: dispatch, each tile's render start and end (written by the
+// renderers into their TimingRing), and when the coordinator saw the last
+// tile land.
+//
+
+#pragma once
+
+#include "frame_sync.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+class FrameTimeline
+{
+public:
+	FrameTimeline(int frames, int renderers);
+
+	void dispatched(int frame, int64_t timeNs) { m_frames[frame].dispatchNs = timeNs; }
+	void completed(int frame, int64_t timeNs) { m_frames[frame].doneNs = timeNs; }
+
+	// Move the records the renderers have written so far out of their rings
+	void collect(FrameSync& sync);
+
+	// Frame time percentiles, jitter, queueing delay and per-renderer
+	// utilisation over the run from startNs to endNs
+	void report(std::ostream& out, int64_t startNs, int64_t endNs) const;
+
+	// Chrome trace event JSON (chrome://tracing, Perfetto): the coordinator's
+	// frames and every renderer's tiles on one timeline
+	bool writeChromeTrace(const std::string& path, std::string& error) const;
+
+private:
+	struct Frame
+	{
+		int64_t dispatchNs = 0;
+		int64_t doneNs = 0;
+	};
+
+	struct Tile
+	{
+		int renderer;
+		TileTiming timing;
+	};
+
+	std::vector<Frame> m_frames;
+	std::vector<Tile> m_tiles;
+	int m_renderers;
+	uint32_t m_dropped = 0;
+};